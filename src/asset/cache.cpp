@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+#include "../include/cache.h"
+
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+struct cache_entry_t
+{
+    cache_type_t type;
+    std::string filename; // empty if not shared
+    void* object; // nullptr once freed
+
+    int references;
+    size_t bytes;
+    int loads;
+    int hits;
+};
+
+static const char* type_names[CACHE_TYPE_COUNT] = { "texture", "sound" };
+
+// Headless games open files from several threads.
+static std::mutex cache_mutex;
+
+// The entries of the files stay once they are freed, for the statistics.
+static std::map<std::string, cache_entry_t*> files[CACHE_TYPE_COUNT];
+static std::unordered_map<void*, cache_entry_t*> objects;
+
+void* cache_find(cache_type_t type, const std::string filename)
+{
+    std::lock_guard<std::mutex> lock(cache_mutex);
+
+    auto found = files[type].find(filename);
+
+    if (found == files[type].end() || found->second->object == nullptr)
+    {
+        return nullptr;
+    }
+
+    cache_entry_t* entry = found->second;
+
+    entry->references++;
+    entry->hits++;
+
+    return entry->object;
+}
+
+void* cache_add(cache_type_t type, const std::string filename, void* object, size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(cache_mutex);
+
+    cache_entry_t* entry;
+
+    if (filename.empty())
+    {
+        entry = new cache_entry_t();
+        entry->type = type;
+    }
+    else
+    {
+        cache_entry_t*& file = files[type][filename];
+
+        if (file == nullptr)
+        {
+            file = new cache_entry_t();
+            file->type = type;
+            file->filename = filename;
+        }
+
+        entry = file;
+
+        if (entry->object != nullptr)
+        {
+            entry->references++;
+            entry->hits++;
+
+            return entry->object;
+        }
+    }
+
+    entry->object = object;
+    entry->references = 1;
+    entry->bytes = bytes;
+    entry->loads++;
+
+    objects[object] = entry;
+
+    return object;
+}
+
+int cache_release(cache_type_t type, void* object)
+{
+    std::lock_guard<std::mutex> lock(cache_mutex);
+
+    auto found = objects.find(object);
+
+    if (found == objects.end())
+    {
+        std::cout << "Freeing a " << type_names[type] << " which was never loaded." << std::endl;
+        return 0;
+    }
+
+    cache_entry_t* entry = found->second;
+
+    if (--entry->references > 0)
+    {
+        return entry->references;
+    }
+
+    objects.erase(found);
+    entry->object = nullptr;
+
+    if (entry->filename.empty())
+    {
+        delete entry;
+    }
+
+    return 0;
+}
+
+static void cache_stats_add(const cache_entry_t* entry, cache_stats_t* stats)
+{
+    if (entry->object != nullptr)
+    {
+        stats->assets++;
+        stats->references += entry->references;
+        stats->bytes += entry->bytes;
+    }
+
+    stats->loads += entry->loads;
+    stats->hits += entry->hits;
+}
+
+void cache_stats_get(cache_type_t type, cache_stats_t* stats)
+{
+    std::lock_guard<std::mutex> lock(cache_mutex);
+
+    *stats = cache_stats_t();
+
+    for (auto& file : files[type])
+    {
+        cache_stats_add(file.second, stats);
+    }
+
+    // The objects without a file.
+    for (auto& object : objects)
+    {
+        if (object.second->type == type && object.second->filename.empty())
+        {
+            cache_stats_add(object.second, stats);
+        }
+    }
+}
+
+int cache_check(cache_type_t type)
+{
+    std::lock_guard<std::mutex> lock(cache_mutex);
+
+    int count = 0;
+
+    for (auto& object : objects)
+    {
+        const cache_entry_t* entry = object.second;
+
+        if (entry->type != type)
+        {
+            continue;
+        }
+
+        std::cout << "The " << type_names[type] << " '"
+                  << (entry->filename.empty() ? "(no file)" : entry->filename)
+                  << "' was not freed, it still has " << entry->references << " reference(s)." << std::endl;
+        count++;
+    }
+
+    return count;
+}
+
+void cache_report()
+{
+    std::lock_guard<std::mutex> lock(cache_mutex);
+
+    std::cout << "Assets                    refs      KB  loads   hits" << std::endl;
+
+    for (int type = 0; type < CACHE_TYPE_COUNT; type++)
+    {
+        for (auto& file : files[type])
+        {
+            const cache_entry_t* entry = file.second;
+            char line[128];
+
+            snprintf(line, sizeof(line), "  %-22s %5d %7.1f %6d %6d",
+                     entry->filename.c_str(), entry->references, entry->bytes / 1024.0,
+                     entry->loads, entry->hits);
+
+            std::cout << line << std::endl;
+        }
+    }
+}
@@ -0,0 +1,376 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+#include "../include/loader.h"
+#include "../include/texture.h"
+#include "../include/audio.h"
+#include "../include/pool.h"
+#include "../include/trace.h"
+#include "../include/pack.h"
+#include "../include/arena.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+enum loader_type_t
+{
+    LOADER_TEXTURE,
+    LOADER_SOUND
+};
+
+struct loader_t
+{
+    loader_type_t type;
+    std::string filename;
+    int frame_count;
+    float frame_duration;
+
+    // Written by the loader thread.
+    bool decoded;
+    bool packed; // the data is in the archive, not to free
+    arena_t* arena; // where the image was decoded
+    const unsigned char* image;
+    int width, height;
+    audio_pcm_t pcm;
+
+    // Only used on the main thread.
+    bool ready;
+    bool closed; // dropped before it was ready
+    texture_t* texture;
+    audio_t* sound;
+};
+
+// A single thread: the loads are decoded in the order they were made.
+static pool_t* pool = nullptr;
+
+static std::mutex decoded_mutex;
+static std::condition_variable decoded_added;
+static std::vector<loader_t*> decoded; // waiting for the upload
+
+static void loader_decode(loader_t* load)
+{
+    if (load->type == LOADER_TEXTURE)
+    {
+        load->arena = arena_create();
+        load->image = texture_decode(load->filename, &load->width, &load->height, load->arena);
+        load->decoded = load->image != nullptr;
+
+        if (!load->decoded)
+        {
+            arena_delete(load->arena);
+            load->arena = nullptr;
+        }
+    }
+    else
+    {
+        load->decoded = audio_sound_decode(load->filename, &load->pcm) != 0;
+    }
+}
+
+// Queue the load for the upload on the main thread.
+static void loader_decoded(loader_t* load)
+{
+    {
+        std::lock_guard<std::mutex> lock(decoded_mutex);
+        decoded.push_back(load);
+    }
+
+    decoded_added.notify_all();
+}
+
+// On the loader thread.
+static void loader_job(void* data)
+{
+    auto load = (loader_t*)data;
+
+    loader_decode(load);
+    loader_decoded(load);
+}
+
+// Free the decoded pixels or samples, and mark the load as ready.
+static void loader_release(loader_t* load)
+{
+    if (load->decoded && load->type == LOADER_TEXTURE)
+    {
+        arena_delete(load->arena);
+        load->arena = nullptr;
+        load->image = nullptr;
+    }
+    else if (load->decoded && load->type == LOADER_SOUND && !load->packed)
+    {
+        audio_pcm_free(&load->pcm);
+    }
+
+    load->decoded = false;
+    load->ready = true;
+}
+
+static void loader_upload(loader_t* load)
+{
+    TRACE_SCOPE_DETAIL("loader_upload", load->filename.c_str());
+
+    if (load->decoded && !load->closed && load->type == LOADER_TEXTURE)
+    {
+        load->texture = texture_from_image(load->filename, load->image, load->width, load->height,
+                                           load->frame_count, load->frame_duration);
+
+        if (load->texture == nullptr)
+        {
+            std::cout << "Failed to load image " << load->filename << " to OpenGL context." << std::endl;
+        }
+    }
+    else if (load->decoded && !load->closed && load->type == LOADER_SOUND)
+    {
+        load->sound = audio_sound_from_pcm(load->filename, &load->pcm);
+    }
+
+    loader_release(load);
+
+    if (load->closed)
+    {
+        delete load;
+    }
+}
+
+static loader_t* loader_create(loader_type_t type, const std::string filename)
+{
+    auto load = new loader_t;
+
+    load->type = type;
+    load->filename = filename;
+    load->frame_count = 1;
+    load->frame_duration = 0.0f;
+    load->decoded = false;
+    load->packed = false;
+    load->arena = nullptr;
+    load->image = nullptr;
+    load->width = 0;
+    load->height = 0;
+    load->pcm.buffer = nullptr;
+    load->pcm.size = 0;
+    load->ready = false;
+    load->closed = false;
+    load->texture = nullptr;
+    load->sound = nullptr;
+
+    return load;
+}
+
+static void loader_start(loader_t* load)
+{
+    // Already loaded, nothing to decode.
+    if (load->type == LOADER_TEXTURE)
+    {
+        load->texture = texture_share(load->filename, load->frame_count);
+    }
+    else
+    {
+        load->sound = audio_sound_share(load->filename);
+    }
+
+    if (load->texture != nullptr || load->sound != nullptr)
+    {
+        load->ready = true;
+        return;
+    }
+
+    // Already decoded in the archive, there is only the upload to do.
+    const pack_entry_t* entry = pack_find(load->filename);
+
+    if (entry != nullptr && entry->type == (load->type == LOADER_TEXTURE ? PACK_IMAGE : PACK_SOUND))
+    {
+        load->decoded = true;
+        load->packed = true;
+
+        if (load->type == LOADER_TEXTURE)
+        {
+            load->image = pack_data(entry);
+            load->width = (int)entry->width;
+            load->height = (int)entry->height;
+            load->frame_count = (int)entry->frame_count;
+            load->frame_duration = entry->frame_duration;
+        }
+        else
+        {
+            load->pcm.channels = (int)entry->channels;
+            load->pcm.samplerate = (long)entry->samplerate;
+            load->pcm.buffer = (char*)pack_data(entry);
+            load->pcm.size = entry->size;
+        }
+
+        if (pool == nullptr)
+        {
+            loader_upload(load);
+        }
+        else
+        {
+            loader_decoded(load);
+        }
+
+        return;
+    }
+
+    if (pool != nullptr)
+    {
+        pool_submit(pool, loader_job, load);
+        return;
+    }
+
+    // No loader thread, do everything now.
+    loader_decode(load);
+    loader_upload(load);
+}
+
+int loader_begin()
+{
+#ifndef __EMSCRIPTEN__
+    pool = pool_create(1);
+#endif
+
+    return 1;
+}
+
+void loader_finish()
+{
+    if (pool != nullptr)
+    {
+        pool_delete(pool);
+        pool = nullptr;
+    }
+
+    std::vector<loader_t*> leftovers;
+
+    {
+        std::lock_guard<std::mutex> lock(decoded_mutex);
+        leftovers.swap(decoded);
+    }
+
+    // Nothing is uploaded anymore: the closed loads are freed, the others
+    // are ready without anything to take, as if they had failed.
+    for (loader_t* load : leftovers)
+    {
+        loader_release(load);
+
+        if (load->closed)
+        {
+            delete load;
+        }
+    }
+}
+
+loader_t* loader_texture(const std::string filename, int frame_count, float frame_duration)
+{
+    loader_t* load = loader_create(LOADER_TEXTURE, filename);
+
+    load->frame_count = frame_count;
+    load->frame_duration = frame_duration;
+    loader_start(load);
+
+    return load;
+}
+
+loader_t* loader_sound(const std::string filename)
+{
+    loader_t* load = loader_create(LOADER_SOUND, filename);
+
+    loader_start(load);
+
+    return load;
+}
+
+void loader_update(float budget)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::vector<loader_t*> uploads;
+    size_t done = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(decoded_mutex);
+        uploads.swap(decoded);
+    }
+
+    // At least one upload is made, so that a large image doesn't wait forever.
+    for (; done < uploads.size(); done++)
+    {
+        if (done > 0 && budget > 0.0f
+            && std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count() >= budget)
+        {
+            break;
+        }
+
+        loader_upload(uploads[done]);
+    }
+
+    if (done < uploads.size())
+    {
+        std::lock_guard<std::mutex> lock(decoded_mutex);
+        decoded.insert(decoded.begin(), uploads.begin() + done, uploads.end());
+    }
+}
+
+int loader_ready(loader_t* load)
+{
+    return load->ready ? 1 : 0;
+}
+
+void loader_wait(loader_t* load)
+{
+    while (!load->ready)
+    {
+        {
+            std::unique_lock<std::mutex> lock(decoded_mutex);
+            decoded_added.wait(lock, [] { return !decoded.empty(); });
+        }
+
+        loader_update(0.0f);
+    }
+}
+
+texture_t* loader_texture_get(loader_t* load)
+{
+    loader_wait(load);
+
+    texture_t* texture = load->texture;
+    delete load;
+
+    return texture;
+}
+
+audio_t* loader_sound_get(loader_t* load)
+{
+    loader_wait(load);
+
+    audio_t* sound = load->sound;
+    delete load;
+
+    return sound;
+}
+
+void loader_close(loader_t* load)
+{
+    if (load == nullptr)
+    {
+        return;
+    }
+
+    if (!load->ready)
+    {
+        // Freed once the loader thread is done with it.
+        load->closed = true;
+        return;
+    }
+
+    texture_close(load->texture);
+    audio_sound_unload(load->sound);
+    delete load;
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+#include "../include/pack.h"
+#include "../include/file.h"
+
+#include <cstring>
+#include <iostream>
+
+// Read only once open, so any thread can look files up.
+static file_map_t* pack_map = nullptr;
+static const pack_entry_t* entries = nullptr;
+static uint32_t entry_count = 0;
+
+// Whether the game can use the entry as it is: the data fits in the
+// archive and has the size the image or sound it describes takes.
+static bool pack_entry_valid(const pack_entry_t* entry, size_t archive_size)
+{
+    if ((size_t)entry->offset + entry->size > archive_size)
+    {
+        return false;
+    }
+
+    if (entry->type == PACK_IMAGE)
+    {
+        return entry->width > 0 && entry->height > 0
+            && (uint64_t)entry->width * entry->height * 4 == entry->size
+            && entry->frame_count > 0 && entry->width % entry->frame_count == 0;
+    }
+
+    if (entry->type == PACK_SOUND)
+    {
+        // OpenAL takes mono and stereo 16-bit samples.
+        return (entry->channels == 1 || entry->channels == 2) && entry->samplerate > 0
+            && entry->size % (entry->channels * 2) == 0;
+    }
+
+    return false;
+}
+
+int pack_open(const std::string filename)
+{
+    pack_close();
+
+    file_map_t* map = file_map(filename);
+
+    if (map == nullptr)
+    {
+        return 0;
+    }
+
+    const unsigned char* data = file_map_data(map);
+    size_t size = file_map_size(map);
+    auto header = (const pack_header_t*)data;
+
+    if (size < sizeof(pack_header_t)
+        || strncmp(header->magic, PACK_MAGIC, sizeof(header->magic)) != 0
+        || size < sizeof(pack_header_t) + (size_t)header->entry_count * sizeof(pack_entry_t))
+    {
+        std::cout << "'" << filename << "' is not an archive of this version." << std::endl;
+        file_unmap(map);
+        return 0;
+    }
+
+    auto first = (const pack_entry_t*)(data + sizeof(pack_header_t));
+
+    for (uint32_t i = 0; i < header->entry_count; i++)
+    {
+        // pack_find looks the names up by bisection.
+        bool sorted = i == 0 || strncmp(first[i - 1].name, first[i].name, PACK_NAME_SIZE) < 0;
+
+        if (!sorted || !pack_entry_valid(&first[i], size))
+        {
+            std::cout << "The archive '" << filename << "' is damaged at '"
+                      << std::string(first[i].name, strnlen(first[i].name, PACK_NAME_SIZE)) << "'." << std::endl;
+            file_unmap(map);
+            return 0;
+        }
+    }
+
+    pack_map = map;
+    entries = first;
+    entry_count = header->entry_count;
+
+    // The archive isn't checked against data/, a file changed since it was
+    // made is only seen once a.man-pack is run again.
+    std::cout << "Using the " << entry_count << " files of '" << filename << "', made by a.man-pack." << std::endl;
+
+    return 1;
+}
+
+void pack_close()
+{
+    file_unmap(pack_map);
+
+    pack_map = nullptr;
+    entries = nullptr;
+    entry_count = 0;
+}
+
+const pack_entry_t* pack_find(const std::string name)
+{
+    uint32_t low = 0, high = entry_count;
+
+    // The entries are sorted by name.
+    while (low < high)
+    {
+        uint32_t middle = (low + high) / 2;
+        int order = strncmp(entries[middle].name, name.c_str(), PACK_NAME_SIZE);
+
+        if (order == 0)
+        {
+            return &entries[middle];
+        }
+
+        if (order < 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return nullptr;
+}
+
+const unsigned char* pack_data(const pack_entry_t* entry)
+{
+    return file_map_data(pack_map) + entry->offset;
+}
@@ -1,58 +1,81 @@
 #include "../include/audio.h"
 #include "../include/vorbis.h"
 #include "../include/openal.h"
+#include "../include/trace.h"
+#include "../include/cache.h"
+#include "../include/pack.h"
 
 #include <list>
 #include <vector>
 #include <iostream>
 
-static int loaded_sound_count = 0;
+static bool null_device = false;
+
+// Without a device, a sound is only something to count.
+struct null_sound_t
+{
+    char unused;
+};
 
 int audio_begin()
 {
+    null_device = false;
     return openal_begin();
 }
 
+int audio_null_begin()
+{
+    null_device = true;
+    return 1;
+}
+
 void audio_finish()
 {
-    if (loaded_sound_count != 0)
+    cache_check(CACHE_SOUND);
+
+    if (!null_device)
     {
-        std::cout << "Asymmetrical call to audio load/unload !" << std::endl;
+        openal_finish();
     }
-
-    openal_finish();
 }
 
-audio_t* audio_sound_load(const std::string filename)
+int audio_sound_decode(const std::string filename, audio_pcm_t* pcm)
 {
-    vorbis_t* vorbis_data;
-
-    int channels;
-    long samplerate;
+    TRACE_SCOPE_DETAIL("audio_sound_decode", filename.c_str());
 
+    vorbis_t* vorbis_data;
     size_t read;
-    size_t buffsize = 0;
+
+    pcm->buffer = nullptr;
+    pcm->size = 0;
 
     if ((vorbis_data = vorbis_open(
             filename,
-            &channels,
-            &samplerate)) == nullptr)
+            &pcm->channels,
+            &pcm->samplerate)) == nullptr)
     {
         std::cout << "Failed to read sound file: " << filename << std::endl;
-        return nullptr;
+        return 0;
+    }
+
+    // Without a device, the samples are never played.
+    if (null_device)
+    {
+        vorbis_close(vorbis_data);
+        return 1;
     }
 
 #define CHUNK_SIZE 512
-    char* buffer = (char*)malloc(CHUNK_SIZE);
+    pcm->buffer = (char*)malloc(CHUNK_SIZE);
 
     while (1)
     {
-        read = vorbis_read(vorbis_data, buffer + buffsize, CHUNK_SIZE);
-        buffsize += read;
+        read = vorbis_read(vorbis_data, pcm->buffer + pcm->size, CHUNK_SIZE);
+        pcm->size += read;
 
         if (read == CHUNK_SIZE)
         {
-            buffer = (char*)realloc(buffer, buffsize + CHUNK_SIZE);
+            pcm->buffer = (char*)realloc(pcm->buffer, pcm->size + CHUNK_SIZE);
         }
         else
         {
@@ -61,39 +84,128 @@ audio_t* audio_sound_load(const std::string filename)
     }
 
     vorbis_close(vorbis_data);
+    return 1;
+}
+
+static void audio_sound_free(audio_t* sound)
+{
+    if (null_device)
+    {
+        delete (null_sound_t*)sound;
+    }
+    else
+    {
+        openal_source_close((openal_t*)sound);
+    }
+}
+
+audio_t* audio_sound_share(const std::string filename)
+{
+    return (audio_t*)cache_find(CACHE_SOUND, filename);
+}
+
+audio_t* audio_sound_from_pcm(const std::string filename, audio_pcm_t* pcm)
+{
+    audio_t* sound;
+
+    if (null_device)
+    {
+        sound = (audio_t*)new null_sound_t;
+    }
+    else
+    {
+        sound = (audio_t*)openal_static_create(pcm->channels, pcm->samplerate, pcm->buffer, pcm->size);
+    }
+
+    if (sound == nullptr)
+    {
+        return nullptr;
+    }
+
+    auto shared = (audio_t*)cache_add(CACHE_SOUND, filename, sound, pcm->size);
+
+    // Loaded by another thread meanwhile.
+    if (shared != sound)
+    {
+        audio_sound_free(sound);
+    }
+
+    return shared;
+}
+
+void audio_pcm_free(audio_pcm_t* pcm)
+{
+    free(pcm->buffer);
+    pcm->buffer = nullptr;
+    pcm->size = 0;
+}
+
+audio_t* audio_sound_load(const std::string filename)
+{
+    TRACE_SCOPE_DETAIL("audio_sound_load", filename.c_str());
 
-    openal_t* source = openal_static_create(channels, samplerate, buffer, buffsize);
-    free(buffer);
+    audio_t* shared = audio_sound_share(filename);
 
-    if (source == nullptr)
+    if (shared != nullptr)
+    {
+        return shared;
+    }
+
+    audio_pcm_t pcm;
+
+    // Already decoded in the archive.
+    const pack_entry_t* entry = pack_find(filename);
+
+    if (entry != nullptr && entry->type == PACK_SOUND)
+    {
+        pcm.channels = (int)entry->channels;
+        pcm.samplerate = (long)entry->samplerate;
+        pcm.buffer = (char*)pack_data(entry);
+        pcm.size = entry->size;
+
+        return audio_sound_from_pcm(filename, &pcm);
+    }
+
+    if (!audio_sound_decode(filename, &pcm))
     {
         return nullptr;
     }
 
-    loaded_sound_count++;
-    return (audio_t*)source;
+    audio_t* sound = audio_sound_from_pcm(filename, &pcm);
+    audio_pcm_free(&pcm);
+
+    return sound;
 }
 
 extern void audio_sound_unload(audio_t* sound)
 {
-	if (sound != nullptr)
+	// Only freed once nothing uses it anymore.
+	if (sound != nullptr && cache_release(CACHE_SOUND, sound) == 0)
 	{
-		loaded_sound_count--;
-		openal_source_close((openal_t*)sound);
+		audio_sound_free(sound);
 	}
 }
 
 extern void audio_sound_play(audio_t* sound)
 {
-    openal_static_play((openal_t*)sound);
+    if (!null_device)
+    {
+        openal_static_play((openal_t*)sound);
+    }
 }
 
 extern void audio_sound_loop(audio_t* sound)
 {
-    openal_static_loop((openal_t*)sound);
+    if (!null_device)
+    {
+        openal_static_loop((openal_t*)sound);
+    }
 }
 
 extern void audio_sound_stop(audio_t* sound)
 {
-    openal_static_stop((openal_t*)sound);
+    if (!null_device)
+    {
+        openal_static_stop((openal_t*)sound);
+    }
 }
\ No newline at end of file
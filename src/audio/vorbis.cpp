@@ -12,14 +12,83 @@
 #include <vorbis/vorbisfile.h>
 
 #include <stdlib.h>
+#include <string.h>
 #include <iostream>
 
 #include "../include/vorbis.h"
+#include "../include/file.h"
 
 struct vorbis_t
 {
     OggVorbis_File vf;
     int current_section;
+
+    // The file is read from memory, see vorbis_callbacks.
+    file_map_t* map;
+    size_t position;
+};
+
+static size_t vorbis_memory_read(void* ptr, size_t size, size_t nmemb, void* datasource)
+{
+    auto data = (vorbis_t*)datasource;
+    size_t left = file_map_size(data->map) - data->position;
+
+    if (size == 0)
+    {
+        return 0;
+    }
+
+    if (nmemb > left / size)
+    {
+        nmemb = left / size;
+    }
+
+    // An empty mapping may have no data at all.
+    if (nmemb == 0)
+    {
+        return 0;
+    }
+
+    memcpy(ptr, file_map_data(data->map) + data->position, nmemb * size);
+    data->position += nmemb * size;
+
+    return nmemb;
+}
+
+static int vorbis_memory_seek(void* datasource, ogg_int64_t offset, int whence)
+{
+    auto data = (vorbis_t*)datasource;
+    ogg_int64_t size = (ogg_int64_t)file_map_size(data->map);
+    ogg_int64_t position;
+
+    switch (whence)
+    {
+    case SEEK_SET: position = offset; break;
+    case SEEK_CUR: position = (ogg_int64_t)data->position + offset; break;
+    case SEEK_END: position = size + offset; break;
+    default: return -1;
+    }
+
+    if (position < 0 || position > size)
+    {
+        return -1;
+    }
+
+    data->position = (size_t)position;
+    return 0;
+}
+
+static long vorbis_memory_tell(void* datasource)
+{
+    return (long)((vorbis_t*)datasource)->position;
+}
+
+// The mapping is freed by vorbis_close.
+static const ov_callbacks vorbis_callbacks = {
+    vorbis_memory_read,
+    vorbis_memory_seek,
+    nullptr,
+    vorbis_memory_tell
 };
 
 vorbis_t* vorbis_open(
@@ -29,9 +98,9 @@ vorbis_t* vorbis_open(
 {
     // Vorbis output is always 16-bits.
     vorbis_t* data;
-    FILE* file;
 
     // Just to remove the header warning.
+    (void)OV_CALLBACKS_DEFAULT;
     (void)OV_CALLBACKS_NOCLOSE;
     (void)OV_CALLBACKS_STREAMONLY;
     (void)OV_CALLBACKS_STREAMONLY_NOCLOSE;
@@ -41,16 +110,20 @@ vorbis_t* vorbis_open(
         return NULL;
     }
 
-    if((file = fopen(filename.c_str(), "rb")) == NULL)
+    // Mapped rather than read, so that the page cache is shared by
+    // every game running on the machine.
+    if ((data->map = file_map(filename)) == NULL)
     {
         free(data);
         return NULL;
     }
 
-    if(ov_open_callbacks(file, &data->vf, NULL, 0, OV_CALLBACKS_DEFAULT) < 0)
+    data->position = 0;
+
+    if(ov_open_callbacks(data, &data->vf, NULL, 0, vorbis_callbacks) < 0)
     {
+        file_unmap(data->map);
         free(data);
-        fclose(file);
         return NULL;
     }
 
@@ -60,8 +133,7 @@ vorbis_t* vorbis_open(
     {
         std::cout << "Only Mono and Stereo sound files are supported!" << std::endl;
 
-        ov_clear(&data->vf);
-        free(data);
+        vorbis_close(data);
         return NULL;
     }
 
@@ -102,5 +174,6 @@ size_t vorbis_read(vorbis_t* data, const char* buffer, size_t buffersize)
 void vorbis_close(vorbis_t* data)
 {
     ov_clear(&data->vf);
+    file_unmap(data->map);
     free(data);
-}
\ No newline at end of file
+}
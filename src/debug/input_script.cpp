@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+#include "../include/input_script.h"
+#include "../include/instance.h"
+
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <vector>
+
+struct input_change_t
+{
+    int update;
+    input_state_t state;
+};
+
+struct input_script_state_t
+{
+    std::vector<input_change_t> changes;
+    size_t change_current;
+};
+
+static input_script_state_t* input_script_current()
+{
+    return instance_state<input_script_state_t>(INSTANCE_INPUT_SCRIPT);
+}
+
+int input_script_open(const std::string filename)
+{
+    input_script_state_t* script = input_script_current();
+
+    std::ifstream file(filename.c_str());
+    std::string line;
+    int line_number = 0;
+
+    if (!file)
+    {
+        std::cout << "Could not open the input script '" << filename << "'." << std::endl;
+        return 0;
+    }
+
+    script->changes.clear();
+    script->change_current = 0;
+
+    while (std::getline(file, line))
+    {
+        std::istringstream words(line);
+        std::string key;
+        input_change_t change;
+
+        line_number++;
+
+        if (!(words >> change.update))
+        {
+            // Empty line or comment
+            continue;
+        }
+
+        change.state = input_state_t();
+
+        while (words >> key)
+        {
+            if (key[0] == '#')
+                break;
+            else if (key == "left")
+                change.state.left = true;
+            else if (key == "right")
+                change.state.right = true;
+            else if (key == "up")
+                change.state.up = true;
+            else if (key == "down")
+                change.state.down = true;
+            else
+            {
+                std::cout << filename << ":" << line_number << ": unknown key '" << key << "'." << std::endl;
+                return 0;
+            }
+        }
+
+        if (!script->changes.empty() && change.update < script->changes.back().update)
+        {
+            std::cout << filename << ":" << line_number << ": the updates must be in order." << std::endl;
+            return 0;
+        }
+
+        script->changes.push_back(change);
+    }
+
+    return 1;
+}
+
+void input_script_close()
+{
+    input_script_state_t* script = input_script_current();
+
+    script->changes.clear();
+    script->change_current = 0;
+}
+
+input_state_t input_script_get(int update)
+{
+    input_script_state_t* script = input_script_current();
+
+    // The updates are usually asked in order, so we continue from the last one.
+    if (script->change_current >= script->changes.size() || script->changes[script->change_current].update > update)
+    {
+        script->change_current = 0;
+    }
+
+    if (script->changes.empty() || script->changes[0].update > update)
+    {
+        return input_state_t();
+    }
+
+    while (script->change_current + 1 < script->changes.size() && script->changes[script->change_current + 1].update <= update)
+    {
+        script->change_current++;
+    }
+
+    return script->changes[script->change_current].state;
+}
+
+int input_script_length()
+{
+    input_script_state_t* script = input_script_current();
+
+    return script->changes.empty() ? 0 : script->changes.back().update;
+}
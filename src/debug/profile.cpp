@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+#include "../include/profile.h"
+
+#ifdef PROFILE
+
+#include "../include/font.h"
+#include "../include/opengl.h"
+#include "../include/batch.h"
+#include "../include/glstate.h"
+#include "../include/cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+#define PROFILE_SAMPLES 240 // 4 seconds at 60 FPS
+
+// The overlay text is only rebuilt every so often, so it stays readable
+// and doesn't fill the text cache with a new string every frame.
+#define HUD_REFRESH_FRAMES 30
+#define HUD_COLUMNS 30
+#define HUD_LINES (PROFILE_PHASE_COUNT + 4)
+
+struct phase_samples_t
+{
+    float values[PROFILE_SAMPLES]; // milliseconds
+    int next;
+    int count;
+};
+
+static const char* phase_names[PROFILE_PHASE_COUNT] = {
+    "frame", "swap", "events", "update", "render", "flush"
+};
+
+static phase_samples_t samples[PROFILE_PHASE_COUNT];
+static std::chrono::steady_clock::time_point last_frame;
+static bool frame_started;
+
+static bool hud_visible;
+static int hud_frames;
+static char hud_text[512];
+
+static void profile_add(profile_phase_t phase, std::chrono::steady_clock::duration duration)
+{
+    phase_samples_t* s = &samples[phase];
+
+    s->values[s->next] = std::chrono::duration<float, std::milli>(duration).count();
+    s->next = (s->next + 1) % PROFILE_SAMPLES;
+
+    if (s->count < PROFILE_SAMPLES)
+    {
+        s->count++;
+    }
+}
+
+profile_scope_t::profile_scope_t(profile_phase_t phase)
+    : phase(phase), start(std::chrono::steady_clock::now())
+{
+}
+
+profile_scope_t::~profile_scope_t()
+{
+    profile_add(phase, std::chrono::steady_clock::now() - start);
+}
+
+void profile_frame()
+{
+    auto now = std::chrono::steady_clock::now();
+
+    if (frame_started)
+    {
+        profile_add(PROFILE_PHASE_FRAME, now - last_frame);
+    }
+
+    last_frame = now;
+    frame_started = true;
+}
+
+void profile_stats_get(profile_phase_t phase, profile_stats_t* stats)
+{
+    const phase_samples_t* s = &samples[phase];
+    float sorted[PROFILE_SAMPLES];
+    float sum = 0.0f;
+
+    if (s->count == 0)
+    {
+        stats->min = stats->mean = stats->p99 = stats->max = 0.0f;
+        return;
+    }
+
+    std::copy(s->values, s->values + s->count, sorted);
+    std::sort(sorted, sorted + s->count);
+
+    for (int i = 0; i < s->count; i++)
+    {
+        sum += sorted[i];
+    }
+
+    stats->min = sorted[0];
+    stats->mean = sum / s->count;
+    stats->p99 = sorted[(s->count - 1) * 99 / 100];
+    stats->max = sorted[s->count - 1];
+}
+
+void profile_hud_toggle()
+{
+    hud_visible = !hud_visible;
+    hud_frames = 0;
+}
+
+static void hud_text_build()
+{
+    batch_stats_t batch;
+    glstate_stats_t gl;
+    cache_stats_t textures, sounds;
+    int length = 0;
+
+    length += snprintf(hud_text + length, sizeof(hud_text) - length, "ms       min  mean   p99   max\n");
+
+    for (int i = 0; i < PROFILE_PHASE_COUNT; i++)
+    {
+        profile_stats_t stats;
+        profile_stats_get((profile_phase_t)i, &stats);
+
+        length += snprintf(hud_text + length, sizeof(hud_text) - length, "%-6s %5.1f %5.1f %5.1f %5.1f\n",
+                           phase_names[i], stats.min, stats.mean, stats.p99, stats.max);
+    }
+
+    cache_stats_get(CACHE_TEXTURE, &textures);
+    cache_stats_get(CACHE_SOUND, &sounds);
+
+    length += snprintf(hud_text + length, sizeof(hud_text) - length, "tex %d %dKB snd %d %dKB\n",
+                       textures.assets, (int)(textures.bytes / 1024), sounds.assets, (int)(sounds.bytes / 1024));
+
+    if (opengl_software_enabled())
+    {
+        snprintf(hud_text + length, sizeof(hud_text) - length, "software renderer");
+        return;
+    }
+
+    batch_stats_get(&batch);
+    glstate_stats_get(&gl);
+
+    snprintf(hud_text + length, sizeof(hud_text) - length, "draws %d quads %d\nbinds %d gl %d/%d",
+             batch.draw_calls, batch.quads, gl.texture_binds, gl.issued, gl.issued + gl.skipped);
+}
+
+void profile_hud_render(font_t* font, opengl_state_t* state)
+{
+    if (!hud_visible)
+    {
+        return;
+    }
+
+    if (hud_frames-- <= 0)
+    {
+        hud_text_build();
+        hud_frames = HUD_REFRESH_FRAMES;
+    }
+
+    opengl_restore(state);
+
+    opengl_move(2, 2);
+    opengl_color(0.0f, 0.0f, 0.0f, 0.6f);
+    opengl_rectangle(HUD_COLUMNS * font_width(font, " ") + 4, HUD_LINES * (font_height(font) + 2) + 2);
+
+    opengl_move(2, 2);
+    opengl_color(1.0f, 1.0f, 1.0f);
+    font_render(font, hud_text);
+
+    opengl_restore(state);
+}
+
+void profile_report()
+{
+    std::cout << "Frame profile (ms)   min   mean    p99    max" << std::endl;
+
+    for (int i = 0; i < PROFILE_PHASE_COUNT; i++)
+    {
+        profile_stats_t stats;
+        char line[128];
+
+        profile_stats_get((profile_phase_t)i, &stats);
+        snprintf(line, sizeof(line), "  %-15s %6.2f %6.2f %6.2f %6.2f",
+                 phase_names[i], stats.min, stats.mean, stats.p99, stats.max);
+
+        std::cout << line << std::endl;
+    }
+
+    cache_report();
+}
+
+#endif
@@ -0,0 +1,312 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+#include "../include/replay.h"
+#include "../include/instance.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+//
+// The file starts with REPLAY_MAGIC, followed by entries of a tag byte and
+// unsigned varints (7 bits per byte, lowest first):
+//
+//   REPLAY_SEED   seed
+//   REPLAY_INPUT  updates since the previous input entry, keys
+//   REPLAY_END    updates since the previous input entry
+//
+// The keys are a bit mask of KEY_UP, KEY_DOWN, KEY_LEFT and KEY_RIGHT.
+// Entries are written as they happen, so a crash keeps everything up to it.
+//
+
+#define REPLAY_MAGIC "a.man-replay-1\n"
+
+#define REPLAY_SEED 1
+#define REPLAY_INPUT 2
+#define REPLAY_END 3
+
+#define KEY_UP 1
+#define KEY_DOWN 2
+#define KEY_LEFT 4
+#define KEY_RIGHT 8
+
+struct replay_change_t
+{
+    int update;
+    unsigned int keys;
+};
+
+struct replay_state_t
+{
+    FILE* record;
+    int record_update; // of the last entry
+    unsigned int keys_last;
+
+    bool playing;
+    std::vector<unsigned int> seeds;
+    size_t seed_next;
+    std::vector<replay_change_t> changes;
+    size_t change_current;
+    int length;
+};
+
+static replay_state_t* replay_current()
+{
+    return instance_state<replay_state_t>(INSTANCE_REPLAY);
+}
+
+static unsigned int keys_encode(input_state_t input)
+{
+    return (input.up ? KEY_UP : 0)
+        | (input.down ? KEY_DOWN : 0)
+        | (input.left ? KEY_LEFT : 0)
+        | (input.right ? KEY_RIGHT : 0);
+}
+
+static input_state_t keys_decode(unsigned int keys)
+{
+    input_state_t input;
+
+    input.up = (keys & KEY_UP) != 0;
+    input.down = (keys & KEY_DOWN) != 0;
+    input.left = (keys & KEY_LEFT) != 0;
+    input.right = (keys & KEY_RIGHT) != 0;
+
+    return input;
+}
+
+static void varint_write(FILE* file, unsigned int value)
+{
+    while (value >= 0x80)
+    {
+        fputc((int)(value & 0x7F) | 0x80, file);
+        value >>= 7;
+    }
+
+    fputc((int)value, file);
+}
+
+static bool varint_read(FILE* file, unsigned int* value)
+{
+    *value = 0;
+
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        int c = fgetc(file);
+
+        if (c == EOF)
+        {
+            return false;
+        }
+
+        *value |= (unsigned int)(c & 0x7F) << shift;
+
+        if ((c & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int replay_record_open(const std::string filename)
+{
+    replay_state_t* replay = replay_current();
+
+    if ((replay->record = fopen(filename.c_str(), "wb")) == nullptr)
+    {
+        std::cout << "Could not open '" << filename << "' for the recording." << std::endl;
+        return 0;
+    }
+
+    fputs(REPLAY_MAGIC, replay->record);
+
+    replay->keys_last = 0;
+    replay->record_update = 0;
+
+    return 1;
+}
+
+int replay_play_open(const std::string filename)
+{
+    replay_state_t* replay = replay_current();
+
+    FILE* file = fopen(filename.c_str(), "rb");
+    char magic[sizeof(REPLAY_MAGIC)];
+    int update = 0;
+    bool ended = false;
+
+    if (file == nullptr)
+    {
+        std::cout << "Could not open the replay '" << filename << "'." << std::endl;
+        return 0;
+    }
+
+    if (fread(magic, 1, strlen(REPLAY_MAGIC), file) != strlen(REPLAY_MAGIC)
+        || memcmp(magic, REPLAY_MAGIC, strlen(REPLAY_MAGIC)) != 0)
+    {
+        std::cout << "'" << filename << "' is not a replay." << std::endl;
+        fclose(file);
+        return 0;
+    }
+
+    replay->seeds.clear();
+    replay->changes.clear();
+
+    while (!ended)
+    {
+        int tag = fgetc(file);
+        unsigned int value, keys;
+
+        if (tag == EOF)
+        {
+            // The recording was interrupted, we play what we have.
+            break;
+        }
+
+        if (!varint_read(file, &value))
+        {
+            break;
+        }
+
+        if (tag == REPLAY_SEED)
+        {
+            replay->seeds.push_back(value);
+        }
+        else if (tag == REPLAY_INPUT && varint_read(file, &keys))
+        {
+            replay_change_t change;
+
+            update += (int)value;
+            change.update = update;
+            change.keys = keys;
+            replay->changes.push_back(change);
+        }
+        else if (tag == REPLAY_END)
+        {
+            update += (int)value;
+            ended = true;
+        }
+        else
+        {
+            std::cout << "The replay '" << filename << "' is corrupted." << std::endl;
+            fclose(file);
+            return 0;
+        }
+    }
+
+    fclose(file);
+
+    replay->playing = true;
+    replay->keys_last = 0;
+    replay->seed_next = 0;
+    replay->change_current = 0;
+    replay->length = update;
+
+    return 1;
+}
+
+void replay_close()
+{
+    replay_state_t* replay = replay_current();
+
+    if (replay->record != nullptr)
+    {
+        fputc(REPLAY_END, replay->record);
+        varint_write(replay->record, (unsigned int)(replay->length - replay->record_update));
+        fclose(replay->record);
+        replay->record = nullptr;
+    }
+
+    replay->playing = false;
+}
+
+bool replay_playing()
+{
+    replay_state_t* replay = replay_current();
+
+    return replay->playing;
+}
+
+int replay_length()
+{
+    replay_state_t* replay = replay_current();
+
+    return replay->length;
+}
+
+unsigned int replay_seed()
+{
+    replay_state_t* replay = replay_current();
+
+    unsigned int seed;
+
+    if (replay->playing)
+    {
+        if (replay->seed_next < replay->seeds.size())
+        {
+            return replay->seeds[replay->seed_next++];
+        }
+
+        std::cout << "The replay has no more random seeds, it will not play the same." << std::endl;
+    }
+
+    std::random_device random_device;
+    seed = random_device();
+
+    if (replay->record != nullptr)
+    {
+        fputc(REPLAY_SEED, replay->record);
+        varint_write(replay->record, seed);
+        fflush(replay->record);
+    }
+
+    return seed;
+}
+
+input_state_t replay_input(int update, input_state_t input)
+{
+    replay_state_t* replay = replay_current();
+
+    if (replay->playing)
+    {
+        while (replay->change_current < replay->changes.size() && replay->changes[replay->change_current].update <= update)
+        {
+            replay->keys_last = replay->changes[replay->change_current].keys;
+            replay->change_current++;
+        }
+
+        return keys_decode(replay->keys_last);
+    }
+
+    if (replay->record != nullptr)
+    {
+        unsigned int keys = keys_encode(input);
+
+        if (keys != replay->keys_last)
+        {
+            fputc(REPLAY_INPUT, replay->record);
+            varint_write(replay->record, (unsigned int)(update - replay->record_update));
+            varint_write(replay->record, keys);
+            fflush(replay->record);
+
+            replay->keys_last = keys;
+            replay->record_update = update;
+        }
+
+        replay->length = update + 1;
+    }
+
+    return input;
+}
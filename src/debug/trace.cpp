@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+#include "../include/trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#define TRACE_CAPACITY 16384 // must be a power of two
+#define TRACE_DETAIL_SIZE 48 // a multiple of 8
+#define TRACE_DETAIL_WORDS (TRACE_DETAIL_SIZE / 8)
+
+// A copy of an event, for the dump.
+struct trace_record_t
+{
+    const char* name;
+    char phase; // 'B' or 'E'
+    unsigned int thread;
+    long long timestamp; // microseconds since trace_begin
+    char detail[TRACE_DETAIL_SIZE];
+};
+
+// Written and read like a seqlock: the fields are atomic so that a reader
+// racing with a writer only gets values it then throws away.
+struct trace_event_t
+{
+    // index + 1 once the event is written, so that a reader can tell
+    // a complete event from one being overwritten.
+    std::atomic<unsigned int> sequence;
+
+    std::atomic<const char*> name;
+    std::atomic<char> phase;
+    std::atomic<unsigned int> thread;
+    std::atomic<long long> timestamp;
+    std::atomic<unsigned long long> detail[TRACE_DETAIL_WORDS];
+};
+
+static trace_event_t events[TRACE_CAPACITY];
+static std::atomic<unsigned int> event_next;
+static std::atomic<bool> enabled;
+
+static std::string trace_filename;
+static std::chrono::steady_clock::time_point trace_start;
+
+static std::atomic<unsigned int> thread_next;
+
+// Small thread numbers are easier to read than the system ones.
+static unsigned int trace_thread_id()
+{
+    static thread_local unsigned int id = 0;
+
+    if (id == 0)
+    {
+        id = ++thread_next;
+    }
+
+    return id;
+}
+
+static void trace_event_add(const char* name, char phase, const char* detail)
+{
+    if (!enabled.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    unsigned int index = event_next.fetch_add(1, std::memory_order_relaxed);
+    trace_event_t* event = &events[index & (TRACE_CAPACITY - 1)];
+
+    unsigned long long words[TRACE_DETAIL_WORDS] = { 0 };
+
+    if (detail != nullptr)
+    {
+        strncpy((char*)words, detail, TRACE_DETAIL_SIZE - 1);
+    }
+
+    long long timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - trace_start).count();
+
+    event->sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    event->name.store(name, std::memory_order_relaxed);
+    event->phase.store(phase, std::memory_order_relaxed);
+    event->thread.store(trace_thread_id(), std::memory_order_relaxed);
+    event->timestamp.store(timestamp, std::memory_order_relaxed);
+
+    for (int i = 0; i < TRACE_DETAIL_WORDS; i++)
+    {
+        event->detail[i].store(words[i], std::memory_order_relaxed);
+    }
+
+    event->sequence.store(index + 1, std::memory_order_release);
+}
+
+int trace_begin(const std::string filename)
+{
+    trace_filename = filename;
+    trace_start = std::chrono::steady_clock::now();
+    event_next = 0;
+    enabled = true;
+
+    return 1;
+}
+
+void trace_finish()
+{
+    if (!enabled)
+    {
+        return;
+    }
+
+    trace_dump();
+    enabled = false;
+}
+
+void trace_event_begin(const char* name, const char* detail)
+{
+    trace_event_add(name, 'B', detail);
+}
+
+void trace_event_end(const char* name)
+{
+    trace_event_add(name, 'E', nullptr);
+}
+
+// Copy the event, false if it is being written or was overwritten
+// meanwhile.
+static bool trace_event_read(trace_event_t* event, unsigned int index, trace_record_t* record)
+{
+    if (event->sequence.load(std::memory_order_acquire) != index + 1)
+    {
+        return false;
+    }
+
+    unsigned long long words[TRACE_DETAIL_WORDS];
+
+    record->name = event->name.load(std::memory_order_relaxed);
+    record->phase = event->phase.load(std::memory_order_relaxed);
+    record->thread = event->thread.load(std::memory_order_relaxed);
+    record->timestamp = event->timestamp.load(std::memory_order_relaxed);
+
+    for (int i = 0; i < TRACE_DETAIL_WORDS; i++)
+    {
+        words[i] = event->detail[i].load(std::memory_order_relaxed);
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (event->sequence.load(std::memory_order_relaxed) != index + 1)
+    {
+        return false;
+    }
+
+    memcpy(record->detail, words, TRACE_DETAIL_SIZE);
+    record->detail[TRACE_DETAIL_SIZE - 1] = '\0';
+
+    return true;
+}
+
+static void trace_write_string(FILE* file, const char* str)
+{
+    fputc('"', file);
+
+    for (; *str != '\0'; str++)
+    {
+        if (*str == '"' || *str == '\\')
+        {
+            fputc('\\', file);
+            fputc(*str, file);
+        }
+        else if ((unsigned char)*str >= ' ')
+        {
+            fputc(*str, file);
+        }
+    }
+
+    fputc('"', file);
+}
+
+void trace_dump()
+{
+    if (!enabled)
+    {
+        return;
+    }
+
+    FILE* file = fopen(trace_filename.c_str(), "w");
+
+    if (file == nullptr)
+    {
+        std::cout << "Could not open '" << trace_filename << "' for the trace." << std::endl;
+        return;
+    }
+
+    unsigned int end = event_next.load(std::memory_order_acquire);
+    unsigned int start = end > TRACE_CAPACITY ? end - TRACE_CAPACITY : 0;
+    bool first = true;
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+    for (unsigned int index = start; index != end; index++)
+    {
+        trace_record_t event;
+
+        // Skip events which are still being written, or were overwritten since.
+        if (!trace_event_read(&events[index & (TRACE_CAPACITY - 1)], index, &event))
+        {
+            continue;
+        }
+
+        fprintf(file, "%s\n{\"name\":", first ? "" : ",");
+        trace_write_string(file, event.name);
+        fprintf(file, ",\"ph\":\"%c\",\"ts\":%lld,\"pid\":1,\"tid\":%u",
+                event.phase, event.timestamp, event.thread);
+
+        if (event.detail[0] != '\0')
+        {
+            fprintf(file, ",\"args\":{\"detail\":");
+            trace_write_string(file, event.detail);
+            fputc('}', file);
+        }
+
+        fputc('}', file);
+        first = false;
+    }
+
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    std::cout << "Trace written to " << trace_filename << std::endl;
+}
@@ -1,4 +1,4 @@
-#include <string>
+#include <cstring>
 
 #include "../include/opengl.h"
 #include "../include/font.h"
@@ -8,11 +8,12 @@ struct dialog_t
 	float start_timer;
 	float position_timer;
 	unsigned int position;
-	std::string text;
+	const char* text;
+	unsigned int length;
 	float r, g, b;
 };
 
-dialog_t* dialog_init(std::string text, float r, float g, float b, float start_time)
+dialog_t* dialog_init(const char* text, float r, float g, float b, float start_time)
 {
 	auto dialog = new dialog_t;
 
@@ -20,6 +21,7 @@ dialog_t* dialog_init(std::string text, float r, float g, float b, float start_t
 	dialog->position_timer = 0.0f;
 	dialog->start_timer = start_time;
 	dialog->text = text;
+	dialog->length = (unsigned int)strlen(text);
 	dialog->r = r;
 	dialog->g = g;
 	dialog->b = b;
@@ -46,7 +48,7 @@ void dialog_update(dialog_t* dialog, float dt)
 
 		if (dialog->position_timer <= 0.0f)
 		{
-			if (dialog->position < dialog->text.length())
+			if (dialog->position < dialog->length)
 			{
 				dialog->position++;
 			}
@@ -69,7 +71,7 @@ int dialog_position_get(dialog_t* dialog)
 
 int dialog_position_max(dialog_t* dialog)
 {
-    return (int)dialog->text.length();
+    return (int)dialog->length;
 }
 
 void dialog_delete(dialog_t* dialog)
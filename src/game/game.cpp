@@ -5,118 +5,323 @@
 #include "../include/texture.h"
 #include "../include/audio.h"
 #include "../include/game.h"
+#include "../include/replay.h"
+#include "../include/instance.h"
+#include "../include/loader.h"
 
 #include <iostream>
 #include <random>
+#include <cmath>
 
-static game_t game;
+#define LEVEL_COUNT 4
 
-static float wave_timer;
-static std::uniform_real_distribution<float> wave_dist(5.0f, 10.0f);
-static std::random_device random_device;
-static std::default_random_engine random_engine(random_device());
+// A longer move in one update is a jump, which isn't interpolated.
+#define FATHER_JUMP 8.0f
 
-#define LEVEL_COUNT 4
-static level_t* levels[LEVEL_COUNT];
+struct game_state_t
+{
+	game_t game;
+
+	float wave_timer;
+	std::uniform_real_distribution<float> wave_dist{5.0f, 10.0f};
+	std::default_random_engine random_engine;
+
+	level_t* levels[LEVEL_COUNT];
+	bool level_resident[LEVEL_COUNT];
+
+	// Loaded on the loader thread while the game waits.
+	loader_t* father_load;
+	loader_t* menu_load;
+	loader_t* talk_load;
+	loader_t* wave_load;
+	int ready;
+
+	// Position of the father before the last update.
+	float father_previous_x, father_previous_y;
+};
+
+static game_state_t* game_scene_current()
+{
+	return instance_state<game_state_t>(INSTANCE_GAME);
+}
 
 extern level_t* level1_get();
 extern level_t* level2_get();
 extern level_t* level3_get();
 extern level_t* level4_get();
 
+// Keep the levels this many changes away from the current one loaded,
+// so that they are there when the player gets to them. The others are
+// unloaded.
+#define LEVEL_RESIDENT_DISTANCE 1
+
+// Load the levels near the current one, and unload the others.
+static void game_residency_update()
+{
+	game_state_t* game_scene = game_scene_current();
+
+	int distance[LEVEL_COUNT];
+	int queue[LEVEL_COUNT];
+	int queue_start = 0, queue_end = 0;
+
+	for (int i = 0; i < LEVEL_COUNT; i++)
+	{
+		distance[i] = -1;
+	}
+
+	distance[game_scene->game.current_level] = 0;
+	queue[queue_end++] = game_scene->game.current_level;
+
+	while (queue_start != queue_end)
+	{
+		level_t* level = game_scene->levels[queue[queue_start]];
+		int next_distance = distance[queue[queue_start++]] + 1;
+
+		if (next_distance > LEVEL_RESIDENT_DISTANCE)
+		{
+			continue;
+		}
+
+		for (int i = 0; i < level->neighbour_count; i++)
+		{
+			int neighbour = level->neighbours[i];
+
+			if (distance[neighbour] < 0)
+			{
+				distance[neighbour] = next_distance;
+				queue[queue_end++] = neighbour;
+			}
+		}
+	}
+
+	for (int i = 0; i < LEVEL_COUNT; i++)
+	{
+		bool wanted = distance[i] >= 0;
+
+		if (wanted && !game_scene->level_resident[i])
+		{
+			game_scene->levels[i]->load();
+		}
+		else if (!wanted && game_scene->level_resident[i])
+		{
+			game_scene->levels[i]->unload();
+		}
+
+		game_scene->level_resident[i] = wanted;
+	}
+}
+
 static void game_finish()
 {
+	game_state_t* game_scene = game_scene_current();
+
+	loader_close(game_scene->father_load);
+	loader_close(game_scene->menu_load);
+	loader_close(game_scene->talk_load);
+	loader_close(game_scene->wave_load);
+
+	game_scene->father_load = nullptr;
+	game_scene->menu_load = nullptr;
+	game_scene->talk_load = nullptr;
+	game_scene->wave_load = nullptr;
+
 	for (int i = 0; i < LEVEL_COUNT; i++)
 	{
-		levels[i]->finish();
+		game_scene->levels[i]->finish();
+		game_scene->level_resident[i] = false;
 	}
 
-	audio_sound_unload(game.talk);
-	audio_sound_unload(game.wave);
+	audio_sound_unload(game_scene->game.talk);
+	audio_sound_unload(game_scene->game.wave);
+
+	texture_close(game_scene->game.father);
+	texture_close(game_scene->game.menu);
 
-	texture_close(game.father);
-	texture_close(game.menu);
+	game_scene->game.talk = nullptr;
+	game_scene->game.wave = nullptr;
+	game_scene->game.father = nullptr;
+	game_scene->game.menu = nullptr;
 }
 
 static bool game_init()
 {
-	game.father = texture_open("data/father.png", 23, 0.2f);
-	game.menu = texture_open("data/menu.png", 9, 0.0f);
-	game.talk = audio_sound_load("data/talk.ogg");
-	game.wave = audio_sound_load("data/wave.ogg");
-
-	game.current_level = 0;
-	game.right_disabled = false;
-
-	if (game.father == nullptr
-		|| game.menu == nullptr
-		|| game.talk == nullptr
-        || game.wave == nullptr)
-	{
-        audio_sound_unload(game.wave);
-		audio_sound_unload(game.talk);
-		texture_close(game.father);
-		texture_close(game.menu);
+	game_state_t* game_scene = game_scene_current();
 
-		return false;
-	}
+	game_scene->random_engine.seed(replay_seed());
+
+	// The scene is only ready once these are loaded, see game_ready.
+	game_scene->father_load = loader_texture("data/father.png", 23, 0.2f);
+	game_scene->menu_load = loader_texture("data/menu.png", 9, 0.0f);
+	game_scene->talk_load = loader_sound("data/talk.ogg");
+	game_scene->wave_load = loader_sound("data/wave.ogg");
+	game_scene->ready = 0;
+
+	game_scene->game.current_level = 0;
+	game_scene->game.right_disabled = false;
 
-	levels[0] = level1_get();
-	levels[1] = level2_get();
-	levels[2] = level3_get();
-	levels[3] = level4_get();
+	game_scene->levels[0] = level1_get();
+	game_scene->levels[1] = level2_get();
+	game_scene->levels[2] = level3_get();
+	game_scene->levels[3] = level4_get();
 
 	for (int i = 0; i < LEVEL_COUNT; i++)
 	{
-		if (!levels[i]->init())
+		game_scene->level_resident[i] = false;
+	}
+
+	return true;
+}
+
+static int game_ready()
+{
+	game_state_t* game_scene = game_scene_current();
+
+	if (game_scene->ready != 0)
+	{
+		return game_scene->ready;
+	}
+
+	// First the files of the game...
+	if (game_scene->father_load != nullptr)
+	{
+		if (!loader_ready(game_scene->father_load)
+			|| !loader_ready(game_scene->menu_load)
+			|| !loader_ready(game_scene->talk_load)
+			|| !loader_ready(game_scene->wave_load))
+		{
+			return 0;
+		}
+
+		game_scene->game.father = loader_texture_get(game_scene->father_load);
+		game_scene->game.menu = loader_texture_get(game_scene->menu_load);
+		game_scene->game.talk = loader_sound_get(game_scene->talk_load);
+		game_scene->game.wave = loader_sound_get(game_scene->wave_load);
+
+		game_scene->father_load = nullptr;
+		game_scene->menu_load = nullptr;
+		game_scene->talk_load = nullptr;
+		game_scene->wave_load = nullptr;
+
+		if (game_scene->game.father == nullptr
+			|| game_scene->game.menu == nullptr
+			|| game_scene->game.talk == nullptr
+			|| game_scene->game.wave == nullptr)
+		{
+			game_scene->ready = -1;
+			return -1;
+		}
+
+		for (int i = 0; i < LEVEL_COUNT; i++)
 		{
-			game_finish();
-			return false;
+			if (!game_scene->levels[i]->init())
+			{
+				game_scene->ready = -1;
+				return -1;
+			}
+
+			game_scene->levels[i]->initialized = true;
 		}
 
-		levels[i]->initialized = true;
+		game_residency_update();
 	}
 
-    wave_timer = wave_dist(random_engine);
-	return true;
+	// ...then the ones of the first level.
+	int loaded = game_scene->levels[game_scene->game.current_level]->loaded(false);
+
+	if (loaded <= 0)
+	{
+		game_scene->ready = loaded;
+		return loaded;
+	}
+
+	game_scene->father_previous_x = game_scene->levels[0]->father_x;
+	game_scene->father_previous_y = game_scene->levels[0]->father_y;
+
+    game_scene->wave_timer = game_scene->wave_dist(game_scene->random_engine);
+
+	game_scene->ready = 1;
+	return 1;
 }
 
 static bool game_update(float dt, input_state_t input_state)
 {
-	int old_level = game.current_level;
-	level_t* level = levels[game.current_level];
-	game.input = input_state;
+	game_state_t* game_scene = game_scene_current();
+
+	if (game_scene->ready != 1)
+	{
+		return true;
+	}
 
-	bool ret = level->update(dt, &game);
+	int old_level = game_scene->game.current_level;
+	level_t* level = game_scene->levels[game_scene->game.current_level];
+	game_scene->game.input = input_state;
+
+	game_scene->father_previous_x = level->father_x;
+	game_scene->father_previous_y = level->father_y;
+
+	bool ret = level->update(dt, &game_scene->game);
 
 	// By definition the level change has to be done in the upate function!
-	if (old_level != game.current_level)
+	if (old_level != game_scene->game.current_level)
 	{
-		level_t* new_level = levels[game.current_level];
+		level_t* new_level = game_scene->levels[game_scene->game.current_level];
+
+		// The new level was near, so it should be loaded already.
+		game_residency_update();
+
+		if (new_level->loaded(true) < 0)
+		{
+			game_scene->ready = -1;
+			return true;
+		}
+
 		new_level->change(level);
+
+		game_scene->father_previous_x = new_level->father_x;
+		game_scene->father_previous_y = new_level->father_y;
 	}
 
-    wave_timer -= dt;
+    game_scene->wave_timer -= dt;
 
-    if (wave_timer <= 0.0f)
+    if (game_scene->wave_timer <= 0.0f)
     {
-        audio_sound_play(game.wave);
-        wave_timer = wave_dist(random_engine);
+        audio_sound_play(game_scene->game.wave);
+        game_scene->wave_timer = game_scene->wave_dist(game_scene->random_engine);
     }
 
 	return ret;
 }
 
-static void game_render(font_t* font, opengl_state_t* state)
+static void game_render(font_t* font, opengl_state_t* state, float alpha)
 {
-	level_t* level = levels[game.current_level];
-	level->render(font, state, &game);
+	game_state_t* game_scene = game_scene_current();
+
+	if (game_scene->ready != 1)
+	{
+		return;
+	}
+
+	level_t* level = game_scene->levels[game_scene->game.current_level];
+	float dx = level->father_x - game_scene->father_previous_x;
+	float dy = level->father_y - game_scene->father_previous_y;
+
+	if (std::fabs(dx) > FATHER_JUMP || std::fabs(dy) > FATHER_JUMP)
+	{
+		alpha = 1.0f;
+	}
+
+	game_scene->game.father_x = game_scene->father_previous_x + dx * alpha;
+	game_scene->game.father_y = game_scene->father_previous_y + dy * alpha;
+
+	level->render(font, state, &game_scene->game);
 }
 
 void game_scene_get(scene_t* scene)
 {
 	scene->init = game_init;
+	scene->ready = game_ready;
 	scene->update = game_update;
 	scene->render = game_render;
 	scene->finish = game_finish;
+	scene->successor = nullptr;
 }
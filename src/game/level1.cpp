@@ -5,22 +5,36 @@
 #include "../include/audio.h"
 #include "../include/level.h"
 #include "../include/game.h"
+#include "../include/instance.h"
+#include "../include/loader.h"
 
 #include <cmath>
 #include <iostream>
 
-static level_t this_level;
-static texture_t* background;
+struct level1_state_t
+{
+	level_t this_level;
+	texture_t* background;
+	loader_t* background_load;
+
+	float monologue_timer;
+	int monologue_played;
 
-static float monologue_timer;
-static int monologue_played;
+	float father_timer;
+	int father_frame;
 
-static float father_timer;
-static int father_frame;
+	bool dont_move_until_release;
 
-static bool dont_move_until_release;
+	int complaint_current;
+	float text_timer;
+};
 
-static std::string complaints_texts[] = {
+static level1_state_t* level1_current()
+{
+	return instance_state<level1_state_t>(INSTANCE_LEVEL1);
+}
+
+static const char* const complaints_texts[] = {
 	"I still think we should go right.",
 	"Not left, right.",
 	"Let's stay on track.",
@@ -31,147 +45,181 @@ static std::string complaints_texts[] = {
 	"Left it is, then.",
 };
 
-static int complaint_current;
-static float text_timer;
+
+static void level1_load()
+{
+	level1_state_t* level1 = level1_current();
+
+	level1->background_load = loader_texture("data/level1.png", 1, 0.0f);
+}
+
+static int level1_loaded(bool wait)
+{
+	level1_state_t* level1 = level1_current();
+
+	if (level1->background_load != nullptr)
+	{
+		if (!wait && !loader_ready(level1->background_load))
+			return 0;
+
+		level1->background = loader_texture_get(level1->background_load);
+		level1->background_load = nullptr;
+	}
+
+	return level1->background != nullptr ? 1 : -1;
+}
+
+static void level1_unload()
+{
+	level1_state_t* level1 = level1_current();
+
+	loader_close(level1->background_load);
+	texture_close(level1->background);
+
+	level1->background_load = nullptr;
+	level1->background = nullptr;
+}
 
 static void level1_finish()
 {
-	if (!this_level.initialized)
+	level1_state_t* level1 = level1_current();
+
+	if (!level1->this_level.initialized)
 		return;
 
-	texture_close(background);
+	level1_unload();
 }
 
 static bool level1_init()
 {
-	if (this_level.initialized)
+	level1_state_t* level1 = level1_current();
+
+	if (level1->this_level.initialized)
 		return true;
-	
-	background = texture_open("data/level1.png", 1, 0.0f);
 
-    monologue_timer = 5.0f;
-    father_timer = 0.0f;
-    father_frame = 0;
-    monologue_played = 0;
+    level1->monologue_timer = 5.0f;
+    level1->father_timer = 0.0f;
+    level1->father_frame = 0;
+    level1->monologue_played = 0;
 
-	dont_move_until_release = false;
+	level1->dont_move_until_release = false;
 
-	complaint_current = -1;
-	text_timer = 0.0f;
-
-    if (background == nullptr)
-    {
-        level1_finish();
-        return false;
-    }
+	level1->complaint_current = -1;
+	level1->text_timer = 0.0f;
 
     return true;
 }
 
 static void move_horizontal(float delta, float old_father_x, float old_father_y)
 {
-    this_level.father_x += delta;
+    level1_state_t* level1 = level1_current();
+
+    level1->this_level.father_x += delta;
 
     // Don't allow to talk on water
-    if (((this_level.father_x < 86 || this_level.father_x > 150) && old_father_y < 57)
+    if (((level1->this_level.father_x < 86 || level1->this_level.father_x > 150) && old_father_y < 57)
         || old_father_y < 24)
     {
-        this_level.father_x = old_father_x;
+        level1->this_level.father_x = old_father_x;
     }
 }
 
 static void move_vertical(float delta, float old_father_x, float old_father_y, game_t* game)
 {
-    this_level.father_y += delta;
+    level1_state_t* level1 = level1_current();
+
+    level1->this_level.father_y += delta;
 
     // Don't allow to talk on water
-    if (((old_father_x < 86 || old_father_x > 150) && this_level.father_y < 57)
-        || this_level.father_y < 24)
+    if (((old_father_x < 86 || old_father_x > 150) && level1->this_level.father_y < 57)
+        || level1->this_level.father_y < 24)
     {
-        this_level.father_y = old_father_y;
+        level1->this_level.father_y = old_father_y;
     }
 
-    if (this_level.father_y >= REFERENCE_HEIGHT - texture_frame_height(game->father) - 25)
+    if (level1->this_level.father_y >= REFERENCE_HEIGHT - texture_frame_height(game->father) - 25)
     {
-        this_level.father_y = REFERENCE_HEIGHT - texture_frame_height(game->father) - 25;
+        level1->this_level.father_y = REFERENCE_HEIGHT - texture_frame_height(game->father) - 25;
     }
 }
 
 static bool level1_update(float dt, game_t* game)
 {
+	level1_state_t* level1 = level1_current();
+
 	float duration = texture_frame_duration(game->father);
 
-	if (monologue_timer > 0.0f)
+	if (level1->monologue_timer > 0.0f)
     {
-        monologue_timer -= dt;
+        level1->monologue_timer -= dt;
 
-		if ((monologue_timer <= 4.2f && monologue_timer >= 3.0f) || monologue_timer <= 2.0f)
+		if ((level1->monologue_timer <= 4.2f && level1->monologue_timer >= 3.0f) || level1->monologue_timer <= 2.0f)
         {
             // To play the "talk" sound in the first two monologues
-            if ((monologue_timer <= 4.2f && monologue_played == 0)
-                || (monologue_timer <= 2.0f && monologue_played == 1))
+            if ((level1->monologue_timer <= 4.2f && level1->monologue_played == 0)
+                || (level1->monologue_timer <= 2.0f && level1->monologue_played == 1))
             {
                 audio_sound_play(game->talk);
-                monologue_played++;
+                level1->monologue_played++;
             }
 
-            father_timer += dt;
+            level1->father_timer += dt;
 
-            if (father_timer >= duration)
+            if (level1->father_timer >= duration)
             {
 				// Talking animation
-				if (father_frame == 0)
-					father_frame = 12;
+				if (level1->father_frame == 0)
+					level1->father_frame = 12;
 				else
-					father_frame = 0;
+					level1->father_frame = 0;
 
-                father_timer -= duration;
+                level1->father_timer -= duration;
             }
         }
 
-		if (monologue_timer <= 0.0f)
+		if (level1->monologue_timer <= 0.0f)
 		{
-			father_timer = 0.0f;
+			level1->father_timer = 0.0f;
 		}
     }
 
-	if (text_timer > 0.0f)
+	if (level1->text_timer > 0.0f)
 	{
-		text_timer -= dt;
-		father_timer += dt;
+		level1->text_timer -= dt;
+		level1->father_timer += dt;
 
-		if (father_timer >= duration)
+		if (level1->father_timer >= duration)
 		{
 			// Talking animation
-			if (father_frame == 0)
-				father_frame = 12;
+			if (level1->father_frame == 0)
+				level1->father_frame = 12;
 			else
-				father_frame = 0;
+				level1->father_frame = 0;
 
-			father_timer -= duration;
+			level1->father_timer -= duration;
 		}
 
-		if (text_timer <= 0.0f)
+		if (level1->text_timer <= 0.0f)
 		{
-			father_timer = 0.0f;
-			dont_move_until_release = true;
+			level1->father_timer = 0.0f;
+			level1->dont_move_until_release = true;
 		}
 	}
 
 	// Don't allow moving until the any text is over
-	if (monologue_timer <= 0.0f)
+	if (level1->monologue_timer <= 0.0f)
 	{
 		bool mouvement = false;
 		int direction = 0;
 
-		if (text_timer <= 0.0f)
+		if (level1->text_timer <= 0.0f)
 		{
-			father_timer += dt;
+			level1->father_timer += dt;
 		}
 
 		if (game->input.left || game->input.right || game->input.up || game->input.down)
 		{
-			if (!dont_move_until_release && text_timer <= 0.0f)
+			if (!level1->dont_move_until_release && level1->text_timer <= 0.0f)
 			{
                 float delta_horizontal = 0.0f;
                 float delta_vertical = 0.0f;
@@ -191,8 +239,8 @@ static bool level1_update(float dt, game_t* game)
 				if (game->input.down)
                     delta_vertical += FATHER_SPEED * dt;
 
-                float old_father_x = this_level.father_x;
-                float old_father_y = this_level.father_y;
+                float old_father_x = level1->this_level.father_x;
+                float old_father_y = level1->this_level.father_y;
 
                 move_horizontal(delta_horizontal, old_father_x, old_father_y);
                 move_vertical(delta_vertical, old_father_x, old_father_y, game);
@@ -216,67 +264,67 @@ static bool level1_update(float dt, game_t* game)
 		
 		if (mouvement)
 		{
-			if (father_timer >= duration)
+			if (level1->father_timer >= duration)
 			{
-				father_timer -= duration;
+				level1->father_timer -= duration;
 
-				int frame = father_frame / 4;
+				int frame = level1->father_frame / 4;
 				frame = (frame + 1) % 3;
-				father_frame = direction + frame * 4;
+				level1->father_frame = direction + frame * 4;
 			}
 		}
 		else
 		{
 			// Reset to the original position of the direction
-			if (father_timer >= duration)
+			if (level1->father_timer >= duration)
 			{
-				father_timer -= duration;
-				father_frame = father_frame % 4;
+				level1->father_timer -= duration;
+				level1->father_frame = level1->father_frame % 4;
 			}
 		}
 
-		if (this_level.father_x <= 45)
+		if (level1->this_level.father_x <= 45)
 		{
-			if (complaint_current < 7)
+			if (level1->complaint_current < 7)
 			{
-				complaint_current++;
+				level1->complaint_current++;
 
                 // Speed things up if we already visited the far left.
                 if (game->right_disabled)
                 {
-                    complaint_current = 7;
+                    level1->complaint_current = 7;
                 }
 
 				audio_sound_play(game->talk);
 
-				this_level.father_x = 46;
+				level1->this_level.father_x = 46;
 
-				text_timer = 1.2f;
-				father_frame = 0;
+				level1->text_timer = 1.2f;
+				level1->father_frame = 0;
 			}
 		}
 
 		// Test if all keys are released.
 		if (!game->input.left && !game->input.right 
 			&& !game->input.up && !game->input.down 
-			&& dont_move_until_release)
+			&& level1->dont_move_until_release)
 		{
-			dont_move_until_release = false;
+			level1->dont_move_until_release = false;
 		}
 	}
 
-	if (this_level.father_x > REFERENCE_WIDTH - texture_frame_width(game->father))
+	if (level1->this_level.father_x > REFERENCE_WIDTH - texture_frame_width(game->father))
 	{
 		// Make sure that if we come back to this screen we won't instantly 
 		// go back to the other scene
-		this_level.father_x--;
+		level1->this_level.father_x--;
 		game->current_level = 1;
 	}
-	else if (this_level.father_x < 0)
+	else if (level1->this_level.father_x < 0)
 	{
-		this_level.father_x++;
+		level1->this_level.father_x++;
 		game->current_level = 2;
-        dont_move_until_release = true;
+        level1->dont_move_until_release = true;
 	}
 
     return true;
@@ -291,31 +339,33 @@ static void color_get(bool state)
 }
 
 static void level1_render(font_t* font, opengl_state_t* state, game_t* game)
-{	
-	int father_x = (int)this_level.father_x;
-	int father_y = (int)this_level.father_y;
+{
+	level1_state_t* level1 = level1_current();
 
-    opengl_texture(background, 0);
+	int father_x = (int)game->father_x;
+	int father_y = (int)game->father_y;
+
+    opengl_texture(level1->background, 0);
     opengl_move(father_x + texture_frame_width(game->father) / 2, father_y - 10);
 	opengl_color(0.0f, 0.0f, 0.0f);
 
-    if (monologue_timer <= 4.0f && monologue_timer >= 3.0f)
+    if (level1->monologue_timer <= 4.0f && level1->monologue_timer >= 3.0f)
     {
-		std::string text = "He's gone.";
+		const char* text = "He's gone.";
 
 		opengl_move(-font_width(font, text) / 2, 0);
 		font_render(font, text);
 	}
-	else if (monologue_timer <= 2.0f && monologue_timer >= 0.0f)
+	else if (level1->monologue_timer <= 2.0f && level1->monologue_timer >= 0.0f)
 	{
-		std::string text = "I guess I should go right.";
+		const char* text = "I guess I should go right.";
 
 		opengl_move(-font_width(font, text) / 2, 0);
 		font_render(font, text);
 	}
-	else if(text_timer > 0.0f)
+	else if(level1->text_timer > 0.0f)
 	{
-		std::string text = complaints_texts[complaint_current];
+		const char* text = complaints_texts[level1->complaint_current];
 		int width = font_width(font, text);
 
 		opengl_move(-width / 2, 0);
@@ -335,7 +385,7 @@ static void level1_render(font_t* font, opengl_state_t* state, game_t* game)
 
 	opengl_restore(state);
 	opengl_move(father_x, father_y);
-	opengl_texture(game->father, father_frame);
+	opengl_texture(game->father, level1->father_frame);
 
 	opengl_restore(state);
 	opengl_move(0, REFERENCE_HEIGHT - 25);
@@ -345,7 +395,7 @@ static void level1_render(font_t* font, opengl_state_t* state, game_t* game)
 	opengl_color(1.0f, 1.0f, 1.0f);
 	opengl_rectangle(REFERENCE_WIDTH, 24);
 
-	if (monologue_timer <= 0.0f)
+	if (level1->monologue_timer <= 0.0f)
 	{
 		int width = texture_frame_width(game->menu);
 		int height = texture_frame_height(game->menu);
@@ -375,28 +425,40 @@ static void level1_render(font_t* font, opengl_state_t* state, game_t* game)
 
 static void level1_change(level_t* old_level)
 {
+	level1_state_t* level1 = level1_current();
+
 	if (old_level->number == 1 || old_level->number == 2)
 	{
-		this_level.father_y = old_level->father_y;
+		level1->this_level.father_y = old_level->father_y;
 	}
 	else
 	{
-		std::cout << "Going to level " << this_level.number + 1 << " from unknown level: " << old_level->number + 1 << std::endl;
+		std::cout << "Going to level " << level1->this_level.number + 1 << " from unknown level: " << old_level->number + 1 << std::endl;
 	}
 }
 
 level_t* level1_get()
 {
-	this_level.number = 0;
-	this_level.father_x = 130.0f;
-	this_level.father_y = 30.0f;
-	this_level.initialized = false;
-
-	this_level.init = level1_init;
-	this_level.update = level1_update;
-	this_level.render = level1_render;
-	this_level.change = level1_change;
-	this_level.finish = level1_finish;
-
-	return &this_level;
+	level1_state_t* level1 = level1_current();
+
+	level1->this_level.number = 0;
+	level1->this_level.father_x = 130.0f;
+	level1->this_level.father_y = 30.0f;
+	level1->this_level.initialized = false;
+
+	// Level 2 and 3.
+	level1->this_level.neighbours[0] = 1;
+	level1->this_level.neighbours[1] = 2;
+	level1->this_level.neighbour_count = 2;
+
+	level1->this_level.init = level1_init;
+	level1->this_level.update = level1_update;
+	level1->this_level.render = level1_render;
+	level1->this_level.change = level1_change;
+	level1->this_level.finish = level1_finish;
+	level1->this_level.load = level1_load;
+	level1->this_level.loaded = level1_loaded;
+	level1->this_level.unload = level1_unload;
+
+	return &level1->this_level;
 }
@@ -6,26 +6,38 @@
 #include "../include/window.h"
 #include "../include/audio.h"
 #include "../include/font.h"
+#include "../include/instance.h"
+#include "../include/loader.h"
 
 #include <iostream>
 
-static texture_t* background;
-static audio_t* drop;
+struct level2_state_t
+{
+	texture_t* background;
+	audio_t* drop;
+	loader_t* background_load;
+	loader_t* drop_load;
+
+	level_t this_level;
 
-static level_t this_level;
+	int father_frame;
+	float father_timer;
+	int repeat_count;
 
-static int father_frame;
-static float father_timer;
-static int repeat_count;
+	int boredom_current;
+	float text_timer;
 
-static int boredom_current;
-static float text_timer;
+	float disable_timer;
+};
 
-static float disable_timer;
+static level2_state_t* level2_current()
+{
+	return instance_state<level2_state_t>(INSTANCE_LEVEL2);
+}
 
 #define BOREDOM_MAX 6
 
-static std::string boredom_text[] = {
+static const char* const boredom_text[] = {
 	"This looks familiar.",
 	"Is this really getting somewhere?",
 	"Again?",
@@ -35,38 +47,72 @@ static std::string boredom_text[] = {
 	"You know what? @#% this."
 };
 
+static void level2_load()
+{
+	level2_state_t* level2 = level2_current();
+
+	level2->background_load = loader_texture("data/level2.png", 1, 0.0f);
+	level2->drop_load = loader_sound("data/drop.ogg");
+}
+
+static int level2_loaded(bool wait)
+{
+	level2_state_t* level2 = level2_current();
+
+	if (level2->background_load != nullptr)
+	{
+		if (!wait && (!loader_ready(level2->background_load) || !loader_ready(level2->drop_load)))
+			return 0;
+
+		level2->background = loader_texture_get(level2->background_load);
+		level2->drop = loader_sound_get(level2->drop_load);
+		level2->background_load = nullptr;
+		level2->drop_load = nullptr;
+	}
+
+	return level2->background != nullptr && level2->drop != nullptr ? 1 : -1;
+}
+
+static void level2_unload()
+{
+	level2_state_t* level2 = level2_current();
+
+	loader_close(level2->background_load);
+	loader_close(level2->drop_load);
+	texture_close(level2->background);
+    audio_sound_unload(level2->drop);
+
+	level2->background_load = nullptr;
+	level2->drop_load = nullptr;
+	level2->background = nullptr;
+	level2->drop = nullptr;
+}
+
 static void level2_finish()
 {
-	if (!this_level.initialized)
+	level2_state_t* level2 = level2_current();
+
+	if (!level2->this_level.initialized)
 		return;
 
-	texture_close(background);
-    audio_sound_unload(drop);
+	level2_unload();
 }
 
 static bool level2_init()
 {
-	if (this_level.initialized)
-		return true;
+	level2_state_t* level2 = level2_current();
 
-	background = texture_open("data/level2.png", 1, 0.0f);
-    drop = audio_sound_load("data/drop.ogg");
+	if (level2->this_level.initialized)
+		return true;
 
-	father_frame = 0;
-	father_timer = 0.0f;
+	level2->father_frame = 0;
+	level2->father_timer = 0.0f;
 
-	repeat_count = 0;
-	boredom_current = -1;
-	text_timer = 0.0f;
+	level2->repeat_count = 0;
+	level2->boredom_current = -1;
+	level2->text_timer = 0.0f;
 
-	disable_timer = 2.0f;
-
-    if (background == nullptr
-     || drop == nullptr)
-    {
-        level2_finish();
-        return false;
-    }
+	level2->disable_timer = 2.0f;
 
     return true;
 }
@@ -81,22 +127,24 @@ static void color_get(bool state)
 
 static void level2_render(font_t* font, opengl_state_t* state, game_t* game)
 {
-	opengl_texture(background, 0);
+	level2_state_t* level2 = level2_current();
 
-	opengl_move((int)this_level.father_x, (int)this_level.father_y);
-	opengl_texture(game->father, father_frame);
+	opengl_texture(level2->background, 0);
 
-	if (text_timer > 0.0f)
+	opengl_move((int)game->father_x, (int)game->father_y);
+	opengl_texture(game->father, level2->father_frame);
+
+	if (level2->text_timer > 0.0f)
 	{
-		std::string text = boredom_text[boredom_current];
+		const char* text = boredom_text[level2->boredom_current];
 		int width = font_width(font, text);
 
 		opengl_move(texture_frame_width(game->father) / 2 - width / 2, -10);
 
 		// Make sure all the text stays on screen. This can only happen on the left in this case
-		if (this_level.father_x + texture_frame_width(game->father) / 2 - width / 2 < 0)
+		if (game->father_x + texture_frame_width(game->father) / 2 - width / 2 < 0)
 		{
-			opengl_move(width / 2 - (int)this_level.father_x - texture_frame_width(game->father) / 2 + 1, 0);
+			opengl_move(width / 2 - (int)game->father_x - texture_frame_width(game->father) / 2 + 1, 0);
 		}
 
 		opengl_color(0.0f, 0.0f, 0.0f);
@@ -138,61 +186,69 @@ static void level2_render(font_t* font, opengl_state_t* state, game_t* game)
 
 static void move_horizontal(float delta, float old_father_x, float old_father_y)
 {
-	this_level.father_x += delta;
+	level2_state_t* level2 = level2_current();
+
+	level2->this_level.father_x += delta;
 
 	// Don't allow to talk on water
-	if (((this_level.father_x < 86 || this_level.father_x > 150) && old_father_y < 57)
+	if (((level2->this_level.father_x < 86 || level2->this_level.father_x > 150) && old_father_y < 57)
 		|| old_father_y < 24)
 	{
-		this_level.father_x = old_father_x;
+		level2->this_level.father_x = old_father_x;
 	}
 }
 
 static void move_vertical(float delta, float old_father_x, float old_father_y, game_t* game)
 {
-	this_level.father_y += delta;
+	level2_state_t* level2 = level2_current();
+
+	level2->this_level.father_y += delta;
 
 	// Don't allow to talk on water
-	if (this_level.father_y < 57)
+	if (level2->this_level.father_y < 57)
 	{
-		this_level.father_y = old_father_y;
+		level2->this_level.father_y = old_father_y;
 	}
 
-	if (this_level.father_y >= REFERENCE_HEIGHT - texture_frame_height(game->father) - 25)
+	if (level2->this_level.father_y >= REFERENCE_HEIGHT - texture_frame_height(game->father) - 25)
 	{
-		this_level.father_y = REFERENCE_HEIGHT - texture_frame_height(game->father) - 25;
+		level2->this_level.father_y = REFERENCE_HEIGHT - texture_frame_height(game->father) - 25;
 	}
 }
 
 static void father_update(float dt, game_t* game)
 {
+    level2_state_t* level2 = level2_current();
+
     float duration = texture_frame_duration(game->father);
 
-    father_timer += dt;
+    level2->father_timer += dt;
 
-    if (father_timer >= duration)
+    if (level2->father_timer >= duration)
     {
         // Talking animation
-        if (father_frame == 0)
-            father_frame = 12;
+        if (level2->father_frame == 0)
+            level2->father_frame = 12;
         else
-            father_frame = 0;
+            level2->father_frame = 0;
 
-        father_timer -= duration;
+        level2->father_timer -= duration;
     }
 }
 
 static bool level2_update(float dt, game_t* game)
 {
+	level2_state_t* level2 = level2_current();
+
 	bool mouvement = false;
 	int direction;
 
-	if (text_timer <= 0.0f)
+	if (level2->text_timer <= 0.0f)
 	{
 		// Go slower each repetition
-		int father_speed = FATHER_SPEED - repeat_count;
+		int father_speed = FATHER_SPEED - level2->repeat_count;
 
-		if (boredom_current != BOREDOM_MAX || disable_timer <= 0.0f)
+		if (level2->boredom_current != BOREDOM_MAX || level2->disable_timer <= 0.0f)
 		{
 			if (game->input.left || game->input.right || game->input.up || game->input.down)
 			{
@@ -214,8 +270,8 @@ static bool level2_update(float dt, game_t* game)
 				if (game->input.down)
 					delta_vertical += father_speed * dt;
 
-				float old_father_x = this_level.father_x;
-				float old_father_y = this_level.father_y;
+				float old_father_x = level2->this_level.father_x;
+				float old_father_y = level2->this_level.father_y;
 
 				move_horizontal(delta_horizontal, old_father_x, old_father_y);
 				move_vertical(delta_vertical, old_father_x, old_father_y, game);
@@ -227,43 +283,43 @@ static bool level2_update(float dt, game_t* game)
 		{
 			int father_height = texture_frame_height(game->father);
 
-			if (!game->right_disabled && this_level.father_y < REFERENCE_HEIGHT - 25 - father_height)
+			if (!game->right_disabled && level2->this_level.father_y < REFERENCE_HEIGHT - 25 - father_height)
 			{
-				this_level.father_y += father_speed * dt;
+				level2->this_level.father_y += father_speed * dt;
 				mouvement = true;
 			}
 
-			if (this_level.father_y >= REFERENCE_HEIGHT - 25 - father_height)
+			if (level2->this_level.father_y >= REFERENCE_HEIGHT - 25 - father_height)
 			{
-				this_level.father_y = REFERENCE_HEIGHT - 25 - father_height;
+				level2->this_level.father_y = REFERENCE_HEIGHT - 25 - father_height;
 
-				if (disable_timer > 1.0f)
+				if (level2->disable_timer > 1.0f)
 				{
-					disable_timer -= dt;
+					level2->disable_timer -= dt;
 
-					if (disable_timer <= 1.0f)
+					if (level2->disable_timer <= 1.0f)
 					{
 						game->right_disabled = true;
-						audio_sound_play(drop);
+						audio_sound_play(level2->drop);
 					}
 				}
-				else if(disable_timer > 0.0f)
+				else if(level2->disable_timer > 0.0f)
 				{
-					disable_timer -= dt;
+					level2->disable_timer -= dt;
 				}
 			}
 		}
 	}
 	else
 	{
-		text_timer -= dt;
+		level2->text_timer -= dt;
 		father_update(dt, game);
 	}
 
 	if (mouvement)
 	{
 		float duration = texture_frame_duration(game->father);
-		father_timer += dt;
+		level2->father_timer += dt;
 
 		// 0 -> down
 		// 1 -> up
@@ -278,53 +334,53 @@ static bool level2_update(float dt, game_t* game)
 		else
 			direction = 0;
 
-		if (father_timer >= duration)
+		if (level2->father_timer >= duration)
 		{
-			father_timer -= duration;
+			level2->father_timer -= duration;
 
-			int frame = father_frame / 4;
+			int frame = level2->father_frame / 4;
 			frame = (frame + 1) % 3;
-			father_frame = direction + frame * 4;
+			level2->father_frame = direction + frame * 4;
 		}
 	}
 
-    if (this_level.father_x < 0)
+    if (level2->this_level.father_x < 0)
     {
-        if (repeat_count > 0)
+        if (level2->repeat_count > 0)
         {
-            this_level.father_x = REFERENCE_WIDTH - texture_frame_width(game->father);
-            repeat_count--;
+            level2->this_level.father_x = REFERENCE_WIDTH - texture_frame_width(game->father);
+            level2->repeat_count--;
         }
         else
         {
-            this_level.father_x++;
+            level2->this_level.father_x++;
             game->current_level--;
         }
     }
 
-	if (boredom_current < BOREDOM_MAX)
+	if (level2->boredom_current < BOREDOM_MAX)
 	{
-		if (repeat_count > 3 && boredom_current % 2
-			&& this_level.father_x > REFERENCE_WIDTH / 2)
+		if (level2->repeat_count > 3 && level2->boredom_current % 2
+			&& level2->this_level.father_x > REFERENCE_WIDTH / 2)
 		{
-			boredom_current++;
+			level2->boredom_current++;
 			audio_sound_play(game->talk);
-			text_timer = 1.2f;
-			father_frame = 0;
+			level2->text_timer = 1.2f;
+			level2->father_frame = 0;
 		}
 	}
 
-	if(this_level.father_x > REFERENCE_WIDTH - texture_frame_width(game->father))
+	if(level2->this_level.father_x > REFERENCE_WIDTH - texture_frame_width(game->father))
 	{
-		repeat_count++;
-		this_level.father_x = 0.0f;
+		level2->repeat_count++;
+		level2->this_level.father_x = 0.0f;
 
-		if (boredom_current < BOREDOM_MAX && repeat_count >= 2)
+		if (level2->boredom_current < BOREDOM_MAX && level2->repeat_count >= 2)
 		{
 			audio_sound_play(game->talk);
-			text_timer = 1.2f;
-			father_frame = 0;
-			boredom_current++;
+			level2->text_timer = 1.2f;
+			level2->father_frame = 0;
+			level2->boredom_current++;
 		}
 	}
 
@@ -333,29 +389,40 @@ static bool level2_update(float dt, game_t* game)
 
 static void level2_change(level_t* old_level)
 {
+	level2_state_t* level2 = level2_current();
+
 	if (old_level->number == 0)
 	{
-		this_level.father_y = old_level->father_y;
-        father_frame = 2;
+		level2->this_level.father_y = old_level->father_y;
+        level2->father_frame = 2;
 	}
 	else
 	{
-		std::cout << "Going to level " << this_level.number + 1 << " from unknown level: " << old_level->number + 1 << std::endl;
+		std::cout << "Going to level " << level2->this_level.number + 1 << " from unknown level: " << old_level->number + 1 << std::endl;
 	}
 }
 
 level_t* level2_get()
 {
-	this_level.number = 1;
-	this_level.father_x = 0.0f;
-	this_level.father_y = 0.0f;
-	this_level.initialized = false;
-
-	this_level.init = level2_init;
-	this_level.update = level2_update;
-	this_level.render = level2_render;
-	this_level.change = level2_change;
-	this_level.finish = level2_finish;
-
-	return &this_level;
+	level2_state_t* level2 = level2_current();
+
+	level2->this_level.number = 1;
+	level2->this_level.father_x = 0.0f;
+	level2->this_level.father_y = 0.0f;
+	level2->this_level.initialized = false;
+
+	// Back to level 1.
+	level2->this_level.neighbours[0] = 0;
+	level2->this_level.neighbour_count = 1;
+
+	level2->this_level.init = level2_init;
+	level2->this_level.update = level2_update;
+	level2->this_level.render = level2_render;
+	level2->this_level.change = level2_change;
+	level2->this_level.finish = level2_finish;
+	level2->this_level.load = level2_load;
+	level2->this_level.loaded = level2_loaded;
+	level2->this_level.unload = level2_unload;
+
+	return &level2->this_level;
 }
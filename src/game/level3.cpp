@@ -6,65 +6,116 @@
 #include "../include/window.h"
 #include "../include/audio.h"
 #include "../include/font.h"
+#include "../include/instance.h"
+#include "../include/loader.h"
 
 #include <iostream>
 
-static texture_t* background;
-static level_t this_level;
+struct level3_state_t
+{
+	texture_t* background;
+	loader_t* background_load;
+	level_t this_level;
+
+	int father_frame;
+	float father_timer;
+
+	float text_timer;
+	bool sound_played;
+
+	float color_current;
+};
 
-static int father_frame;
-static float father_timer;
+static level3_state_t* level3_current()
+{
+	return instance_state<level3_state_t>(INSTANCE_LEVEL3);
+}
 
-static float text_timer;
-static bool sound_played;
+static void level3_load()
+{
+	level3_state_t* level3 = level3_current();
 
-static float color_current;
+	level3->background_load = loader_texture("data/level3.png", 1, 0.0f);
+}
+
+static int level3_loaded(bool wait)
+{
+	level3_state_t* level3 = level3_current();
+
+	if (level3->background_load != nullptr)
+	{
+		if (!wait && !loader_ready(level3->background_load))
+			return 0;
+
+		level3->background = loader_texture_get(level3->background_load);
+		level3->background_load = nullptr;
+	}
+
+	return level3->background != nullptr ? 1 : -1;
+}
+
+static void level3_unload()
+{
+	level3_state_t* level3 = level3_current();
+
+	loader_close(level3->background_load);
+	texture_close(level3->background);
+
+	level3->background_load = nullptr;
+	level3->background = nullptr;
+}
 
 static void level3_finish()
 {
-	if (!this_level.initialized)
+	level3_state_t* level3 = level3_current();
+
+	if (!level3->this_level.initialized)
 		return;
 
-	texture_close(background);
+	level3_unload();
 }
 
 static bool level3_init()
 {
-	if (this_level.initialized)
-		return true;
+	level3_state_t* level3 = level3_current();
 
-	background = texture_open("data/level3.png", 1, 0.0f);
+	if (level3->this_level.initialized)
+		return true;
 
-	father_frame = 0;
-	father_timer = 0.0f;
-    text_timer = 0.0f;
-    sound_played = false;
-    color_current = 1.0f;
+	level3->father_frame = 0;
+	level3->father_timer = 0.0f;
+    level3->text_timer = 0.0f;
+    level3->sound_played = false;
+    level3->color_current = 1.0f;
 
-    return background != nullptr;
+    return true;
 }
 
 static void color_get(bool state)
 {
+	level3_state_t* level3 = level3_current();
+
 	if (state)
-		opengl_color(color_current / 2.0f, color_current / 2.0f, color_current / 2.0f);
+		opengl_color(level3->color_current / 2.0f, level3->color_current / 2.0f, level3->color_current / 2.0f);
 	else
-		opengl_color(color_current, color_current, color_current);
+		opengl_color(level3->color_current, level3->color_current, level3->color_current);
 }
 
 static void level3_render(font_t* font, opengl_state_t* state, game_t* game)
 {
+    level3_state_t* level3 = level3_current();
+
     // The screen will fade to black as the character moves left.
-    opengl_color(color_current, color_current, color_current);
+    opengl_color(level3->color_current, level3->color_current, level3->color_current);
 
-	opengl_texture(background, 0);
+	opengl_texture(level3->background, 0);
 
-	opengl_move((int)this_level.father_x, (int)this_level.father_y);
-	opengl_texture(game->father, father_frame);
+	opengl_move((int)game->father_x, (int)game->father_y);
+	opengl_texture(game->father, level3->father_frame);
 
-    if (text_timer > 1.0f && text_timer <= 2.1f)
+    if (level3->text_timer > 1.0f && level3->text_timer <= 2.1f)
     {
-        std::string text;
+        const char* text;
 
         if (game->right_disabled)
             text = "No turning back now.";
@@ -76,9 +127,9 @@ static void level3_render(font_t* font, opengl_state_t* state, game_t* game)
         opengl_move(texture_frame_width(game->father) / 2 - width / 2, -10);
 
         // Make sure all the text stays on screen. This can only happen on the right in this case
-        if (this_level.father_x + texture_frame_width(game->father) / 2 + width / 2 > REFERENCE_WIDTH)
+        if (game->father_x + texture_frame_width(game->father) / 2 + width / 2 > REFERENCE_WIDTH)
         {
-            opengl_move(REFERENCE_WIDTH - width / 2 - (int)this_level.father_x - texture_frame_width(game->father) / 2, 0);
+            opengl_move(REFERENCE_WIDTH - width / 2 - (int)game->father_x - texture_frame_width(game->father) / 2, 0);
         }
 
         opengl_color(0.0f, 0.0f, 0.0f);
@@ -90,7 +141,7 @@ static void level3_render(font_t* font, opengl_state_t* state, game_t* game)
 	opengl_color(0.0f, 0.0f, 0.0f);
 	opengl_rectangle(REFERENCE_WIDTH, 1);
 	opengl_move(0, 1);
-	opengl_color(color_current, color_current, color_current);
+	opengl_color(level3->color_current, level3->color_current, level3->color_current);
 	opengl_rectangle(REFERENCE_WIDTH, 24);
 
 	int width = texture_frame_width(game->menu);
@@ -120,32 +171,36 @@ static void level3_render(font_t* font, opengl_state_t* state, game_t* game)
 
 static void father_update(float dt, game_t* game)
 {
+	level3_state_t* level3 = level3_current();
+
 	float duration = texture_frame_duration(game->father);
 
-	father_timer += dt;
+	level3->father_timer += dt;
 
-	if (father_timer >= duration)
+	if (level3->father_timer >= duration)
 	{
 		// Talking animation
-		if (father_frame == 0)
-			father_frame = 12;
+		if (level3->father_frame == 0)
+			level3->father_frame = 12;
 		else
-			father_frame = 0;
+			level3->father_frame = 0;
 
-		father_timer -= duration;
+		level3->father_timer -= duration;
 	}
 }
 
 static bool level3_update(float dt, game_t* game)
 {
-    text_timer += dt;
+    level3_state_t* level3 = level3_current();
+
+    level3->text_timer += dt;
 
-    if (text_timer >= 1.0f)
+    if (level3->text_timer >= 1.0f)
     {
-        if (!sound_played)
+        if (!level3->sound_played)
         {
             audio_sound_play(game->talk);
-            sound_played = true;
+            level3->sound_played = true;
         }
 
         // If we didn't get full to the right, simply go back
@@ -153,27 +208,27 @@ static bool level3_update(float dt, game_t* game)
         {
             father_update(dt, game);
 
-            if (text_timer >= 2.1f)
+            if (level3->text_timer >= 2.1f)
             {
                 game->current_level = 0;
             }
         }
         else
         {
-            if (text_timer <= 2.1f)
+            if (level3->text_timer <= 2.1f)
             {
                 father_update(dt, game);
             }
-            else if (text_timer >= 3.1f)
+            else if (level3->text_timer >= 3.1f)
             {
                 // We already went right and can't turn right.
                 // So we go left.
-                father_frame = 3;
+                level3->father_frame = 3;
 
-                this_level.father_x -= 5.0f * dt;
-                color_current -= dt / 20.0f;
+                level3->this_level.father_x -= 5.0f * dt;
+                level3->color_current -= dt / 20.0f;
 
-                if (color_current <= 0.0f)
+                if (level3->color_current <= 0.0f)
                 {
                     game->current_level = 3;
                 }
@@ -186,37 +241,49 @@ static bool level3_update(float dt, game_t* game)
 
 static void level3_change(level_t* old_level)
 {
+	level3_state_t* level3 = level3_current();
+
 	if (old_level->number == 0)
 	{
-		this_level.father_y = old_level->father_y;
-		this_level.father_x = REFERENCE_WIDTH - 50;
+		level3->this_level.father_y = old_level->father_y;
+		level3->this_level.father_x = REFERENCE_WIDTH - 50;
 
-        text_timer = 0.0f;
-        sound_played = false;
+        level3->text_timer = 0.0f;
+        level3->sound_played = false;
 	}
 	else if (old_level->number == 1)
 	{
-		this_level.father_y = old_level->father_y;
-		this_level.father_x = 50;
+		level3->this_level.father_y = old_level->father_y;
+		level3->this_level.father_x = 50;
 	}
 	else
 	{
-		std::cout << "Going to level " << this_level.number + 1 << " from unknown level: " << old_level->number + 1 << std::endl;
+		std::cout << "Going to level " << level3->this_level.number + 1 << " from unknown level: " << old_level->number + 1 << std::endl;
 	}
 }
 
 level_t* level3_get()
 {
-	this_level.number = 2;
-	this_level.father_x = 0.0f;
-	this_level.father_y = 0.0f;
-	this_level.initialized = false;
-
-	this_level.init = level3_init;
-	this_level.update = level3_update;
-	this_level.render = level3_render;
-	this_level.change = level3_change;
-	this_level.finish = level3_finish;
-
-	return &this_level;
+	level3_state_t* level3 = level3_current();
+
+	level3->this_level.number = 2;
+	level3->this_level.father_x = 0.0f;
+	level3->this_level.father_y = 0.0f;
+	level3->this_level.initialized = false;
+
+	// Back to level 1, or on to level 4.
+	level3->this_level.neighbours[0] = 0;
+	level3->this_level.neighbours[1] = 3;
+	level3->this_level.neighbour_count = 2;
+
+	level3->this_level.init = level3_init;
+	level3->this_level.update = level3_update;
+	level3->this_level.render = level3_render;
+	level3->this_level.change = level3_change;
+	level3->this_level.finish = level3_finish;
+	level3->this_level.load = level3_load;
+	level3->this_level.loaded = level3_loaded;
+	level3->this_level.unload = level3_unload;
+
+	return &level3->this_level;
 }
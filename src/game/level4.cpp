@@ -5,41 +5,91 @@
 #include "../include/window.h"
 #include "../include/font.h"
 #include "../include/texture.h"
+#include "../include/instance.h"
+#include "../include/loader.h"
 
-static texture_t* heart;
-static level_t this_level;
-static float timer;
+struct level4_state_t
+{
+    texture_t* heart;
+    loader_t* heart_load;
+    level_t this_level;
+    float timer;
+};
+
+static level4_state_t* level4_current()
+{
+    return instance_state<level4_state_t>(INSTANCE_LEVEL4);
+}
+
+static void level4_load()
+{
+    level4_state_t* level4 = level4_current();
+
+    level4->heart_load = loader_texture("data/heart.png", 1, 0.0f);
+}
+
+static int level4_loaded(bool wait)
+{
+    level4_state_t* level4 = level4_current();
+
+    if (level4->heart_load != nullptr)
+    {
+        if (!wait && !loader_ready(level4->heart_load))
+            return 0;
+
+        level4->heart = loader_texture_get(level4->heart_load);
+        level4->heart_load = nullptr;
+    }
+
+    return level4->heart != nullptr ? 1 : -1;
+}
+
+static void level4_unload()
+{
+    level4_state_t* level4 = level4_current();
+
+    loader_close(level4->heart_load);
+    texture_close(level4->heart);
+
+    level4->heart_load = nullptr;
+    level4->heart = nullptr;
+}
 
 static void level4_finish()
 {
-    if (!this_level.initialized)
+    level4_state_t* level4 = level4_current();
+
+    if (!level4->this_level.initialized)
         return;
 
-    texture_close(heart);
+    level4_unload();
 }
 
 static bool level4_init()
 {
-    if (this_level.initialized)
+    level4_state_t* level4 = level4_current();
+
+    if (level4->this_level.initialized)
         return true;
 
-    heart = texture_open("data/heart.png", 1, 0.0f);
-    timer = 0.0f;
+    level4->timer = 0.0f;
 
-    return heart != nullptr;
+    return true;
 }
 
 static void level4_render(font_t* font, opengl_state_t* state, game_t* game)
 {
+    level4_state_t* level4 = level4_current();
+
     // Draw everything in black
     opengl_color(0.0f, 0.0f, 0.0f);
     opengl_rectangle(REFERENCE_WIDTH, REFERENCE_HEIGHT);
 
     // Add some text.
-    if (timer >= 2.0f)
+    if (level4->timer >= 2.0f)
     {
-        float c = (timer - 2.0f) / 2.0f;
-        std::string text1 = "I am here my love.";
+        float c = (level4->timer - 2.0f) / 2.0f;
+        const char* text1 = "I am here my love.";
 
         if (c > 1.0f)
             c = 1.0f;
@@ -49,14 +99,14 @@ static void level4_render(font_t* font, opengl_state_t* state, game_t* game)
         font_render(font, text1);
     }
 
-    if (timer >= 4.0f)
+    if (level4->timer >= 4.0f)
     {
-        float c2 = (timer - 4.0f) / 2.0f;
+        float c2 = (level4->timer - 4.0f) / 2.0f;
 
         if (c2 > 1.0f)
             c2 = 1.0f;
 
-        std::string text2 = "We are finally together again.";
+        const char* text2 = "We are finally together again.";
 
         opengl_restore(state);
         opengl_color(c2, c2, c2);
@@ -64,23 +114,25 @@ static void level4_render(font_t* font, opengl_state_t* state, game_t* game)
         font_render(font, text2);
     }
 
-    if (timer >= 6.0f)
+    if (level4->timer >= 6.0f)
     {
-        float c3 = (timer - 6.0f) / 2.0f;
+        float c3 = (level4->timer - 6.0f) / 2.0f;
 
         if (c3 > 1.0f)
             c3 = 1.0f;
 
         opengl_restore(state);
         opengl_color(c3, c3, c3);
-        opengl_move(REFERENCE_WIDTH / 2 - texture_frame_width(heart) / 2, 90);
-        opengl_texture(heart, 0);
+        opengl_move(REFERENCE_WIDTH / 2 - texture_frame_width(level4->heart) / 2, 90);
+        opengl_texture(level4->heart, 0);
     }
 }
 
 static bool level4_update(float dt, game_t* game)
 {
-    timer += dt;
+    level4_state_t* level4 = level4_current();
+
+    level4->timer += dt;
     return true;
 }
 
@@ -90,16 +142,24 @@ static void level4_change(level_t* old_level)
 
 level_t* level4_get()
 {
-    this_level.number = 3;
-    this_level.father_x = 0.0f;
-    this_level.father_y = 0.0f;
-    this_level.initialized = false;
-
-    this_level.init = level4_init;
-    this_level.update = level4_update;
-    this_level.render = level4_render;
-    this_level.change = level4_change;
-    this_level.finish = level4_finish;
-
-    return &this_level;
+    level4_state_t* level4 = level4_current();
+
+    level4->this_level.number = 3;
+    level4->this_level.father_x = 0.0f;
+    level4->this_level.father_y = 0.0f;
+    level4->this_level.initialized = false;
+
+    // The end.
+    level4->this_level.neighbour_count = 0;
+
+    level4->this_level.init = level4_init;
+    level4->this_level.update = level4_update;
+    level4->this_level.render = level4_render;
+    level4->this_level.change = level4_change;
+    level4->this_level.finish = level4_finish;
+    level4->this_level.load = level4_load;
+    level4->this_level.loaded = level4_loaded;
+    level4->this_level.unload = level4_unload;
+
+    return &level4->this_level;
 }
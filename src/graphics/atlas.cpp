@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+#include <GL/glew.h>
+
+#include "../include/atlas.h"
+#include "../include/glstate.h"
+
+#include <cstdlib>
+
+// Every asset in data/ fits in a single page of this size.
+#define ATLAS_PAGE_SIZE 1024
+#define ATLAS_MAX_PAGES 4
+#define ATLAS_MAX_SHELVES 64
+#define ATLAS_MAX_HOLES 64
+
+// Empty pixels between two images, so that sampling never bleeds into the neighbour.
+#define ATLAS_PADDING 1
+
+// Images are packed left to right on horizontal shelves.
+struct shelf_t
+{
+    int y, height;
+    int x; // next free column
+};
+
+// Space left by a removed image, inside a shelf.
+struct hole_t
+{
+    int x, y, width, height;
+};
+
+struct page_t
+{
+    GLuint texid;
+    int region_count;
+
+    shelf_t shelves[ATLAS_MAX_SHELVES];
+    int shelf_count;
+    int y; // top of the unused space below the last shelf
+
+    hole_t holes[ATLAS_MAX_HOLES];
+    int hole_count;
+};
+
+static page_t pages[ATLAS_MAX_PAGES];
+
+static int page_create(page_t* page)
+{
+    GLint max_size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+
+    if (max_size < ATLAS_PAGE_SIZE)
+    {
+        return 0;
+    }
+
+    // Start from a transparent page so the padding is well defined.
+    auto blank = (unsigned char*)calloc(ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE, 4);
+
+    glGenTextures(1, &page->texid);
+    glstate_bind_texture(page->texid);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+    glTexImage2D(
+            GL_TEXTURE_2D,
+            0,
+            GL_RGBA,
+            ATLAS_PAGE_SIZE,
+            ATLAS_PAGE_SIZE,
+            0,
+            GL_RGBA,
+            GL_UNSIGNED_BYTE,
+            blank);
+
+    free(blank);
+
+    page->region_count = 0;
+    page->shelf_count = 0;
+    page->y = 0;
+    page->hole_count = 0;
+
+    return page->texid != 0;
+}
+
+static void page_add_hole(page_t* page, int x, int y, int width, int height)
+{
+    // A full list only loses the space until the page is released.
+    if (width > 0 && height > 0 && page->hole_count < ATLAS_MAX_HOLES)
+    {
+        hole_t* hole = &page->holes[page->hole_count++];
+
+        hole->x = x;
+        hole->y = y;
+        hole->width = width;
+        hole->height = height;
+    }
+}
+
+// Put the image in the smallest hole it fits in, the rest of the hole
+// (on its right, and below it) staying free. Levels which are unloaded
+// and loaded again get back the hole they left.
+static int page_allocate_hole(page_t* page, int width, int height, int* x, int* y)
+{
+    hole_t* best = nullptr;
+
+    for (int i = 0; i < page->hole_count; i++)
+    {
+        hole_t* hole = &page->holes[i];
+
+        if (hole->width >= width && hole->height >= height
+            && (best == nullptr || hole->width * hole->height < best->width * best->height))
+        {
+            best = hole;
+        }
+    }
+
+    if (best == nullptr)
+    {
+        return 0;
+    }
+
+    hole_t taken = *best;
+    *best = page->holes[--page->hole_count];
+
+    *x = taken.x;
+    *y = taken.y;
+
+    page_add_hole(page, taken.x + width, taken.y, taken.width - width, height);
+    page_add_hole(page, taken.x, taken.y + height, taken.width, taken.height - height);
+
+    return 1;
+}
+
+// Find room for a width x height rectangle. Returns 0 if the page is full.
+static int page_allocate(page_t* page, int width, int height, int* x, int* y)
+{
+    if (page_allocate_hole(page, width, height, x, y))
+    {
+        return 1;
+    }
+
+    shelf_t* best = nullptr;
+
+    // Use the lowest shelf that is tall enough, to waste as little space as possible.
+    for (int i = 0; i < page->shelf_count; i++)
+    {
+        shelf_t* shelf = &page->shelves[i];
+
+        if (shelf->height >= height
+            && shelf->x + width <= ATLAS_PAGE_SIZE
+            && (best == nullptr || shelf->height < best->height))
+        {
+            best = shelf;
+        }
+    }
+
+    if (best == nullptr)
+    {
+        if (page->shelf_count == ATLAS_MAX_SHELVES
+            || page->y + height > ATLAS_PAGE_SIZE)
+        {
+            return 0;
+        }
+
+        best = &page->shelves[page->shelf_count++];
+        best->y = page->y;
+        best->height = height;
+        best->x = 0;
+
+        page->y += height;
+    }
+
+    *x = best->x;
+    *y = best->y;
+    best->x += width;
+
+    return 1;
+}
+
+int atlas_add(const unsigned char* pixels, int width, int height, atlas_region_t* region)
+{
+    int padded_width = width + ATLAS_PADDING;
+    int padded_height = height + ATLAS_PADDING;
+
+    if (padded_width > ATLAS_PAGE_SIZE || padded_height > ATLAS_PAGE_SIZE)
+    {
+        return 0;
+    }
+
+    for (int i = 0; i < ATLAS_MAX_PAGES; i++)
+    {
+        page_t* page = &pages[i];
+        int x, y;
+
+        if (page->texid == 0 && !page_create(page))
+        {
+            return 0;
+        }
+
+        if (!page_allocate(page, padded_width, padded_height, &x, &y))
+        {
+            continue;
+        }
+
+        int unpack;
+
+        glstate_bind_texture(page->texid);
+        glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpack);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+        glTexSubImage2D(
+                GL_TEXTURE_2D,
+                0,
+                x,
+                y,
+                (GLsizei)width,
+                (GLsizei)height,
+                GL_RGBA,
+                GL_UNSIGNED_BYTE,
+                pixels);
+
+        // The space may have held another image, clear the padding again.
+        static const unsigned char transparent[ATLAS_PAGE_SIZE * ATLAS_PADDING * 4] = { 0 };
+
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x + width, y, ATLAS_PADDING, padded_height,
+                        GL_RGBA, GL_UNSIGNED_BYTE, transparent);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x, y + height, width, ATLAS_PADDING,
+                        GL_RGBA, GL_UNSIGNED_BYTE, transparent);
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, unpack);
+
+        page->region_count++;
+
+        region->page = i;
+        region->texid = page->texid;
+        region->u0 = (GLfloat)x / ATLAS_PAGE_SIZE;
+        region->v0 = (GLfloat)y / ATLAS_PAGE_SIZE;
+        region->u1 = (GLfloat)(x + width) / ATLAS_PAGE_SIZE;
+        region->v1 = (GLfloat)(y + height) / ATLAS_PAGE_SIZE;
+        region->x = x;
+        region->y = y;
+        region->width = padded_width;
+        region->height = padded_height;
+
+        return 1;
+    }
+
+    return 0;
+}
+
+void atlas_remove(atlas_region_t* region)
+{
+    page_t* page = &pages[region->page];
+
+    if (--page->region_count == 0)
+    {
+        glstate_delete_textures(1, &page->texid);
+        page->texid = 0;
+        return;
+    }
+
+    // The pixels left there are never sampled, the next image covers them.
+    page_add_hole(page, region->x, region->y, region->width, region->height);
+}
+
+void atlas_finish()
+{
+    for (int i = 0; i < ATLAS_MAX_PAGES; i++)
+    {
+        if (pages[i].texid != 0)
+        {
+            glstate_delete_textures(1, &pages[i].texid);
+            pages[i].texid = 0;
+        }
+    }
+}
@@ -0,0 +1,442 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+#include <GL/glew.h>
+
+#include "../include/batch.h"
+#include "../include/glstate.h"
+
+#include <iostream>
+#include <cstdlib>
+
+// Indices are 16 bits, so a batch can hold at most 65536 / 4 quads.
+#define BATCH_MAX_QUADS 2048
+
+struct shader_t
+{
+    GLuint program, vertexShader, fragmentShader;
+    GLint samplerLoc, projectionLoc;
+    GLint positionLoc, texCoordLoc, colorLoc; // per vertex
+    GLint cornerLoc, rectLoc, frameLoc; // per instance, colorLoc too
+    bool attributesSet;
+};
+
+// One corner of a quad, when instancing is not available.
+struct batch_vertex_t
+{
+    GLfloat x, y; // position
+    GLfloat u, v; // texture coordinate
+    GLfloat r, g, b, a; // color
+};
+
+static shader_t default_shader;
+static bool instancing;
+
+static GLuint quadObject; // the quads, or their vertices
+static GLuint indexObject, cornerObject;
+
+static batch_quad_t quads[BATCH_MAX_QUADS];
+static batch_vertex_t vertices[BATCH_MAX_QUADS * 4];
+static int quad_count;
+
+static GLuint current_texid;
+static GLfloat* current_projection;
+
+static batch_stats_t frame_stats, last_frame_stats;
+
+static const char default_vertex_shader[] =
+    "uniform mat4 projection;                                \n"
+    "attribute vec2 position;                                \n"
+    "attribute vec2 a_texCoord;                              \n"
+    "attribute vec4 a_color;                                 \n"
+    "varying vec2 v_texCoord;                                \n"
+    "varying vec4 v_color;                                   \n"
+    "void main()                                             \n"
+    "{                                                       \n"
+    "   gl_Position = projection * vec4(position, 0.0, 1.0); \n"
+    "   v_texCoord = a_texCoord;                             \n"
+    "   v_color = a_color;                                   \n"
+    "}                                                       \n";
+
+// The same unit quad is drawn once per sprite, placed by per-instance attributes.
+static const char instanced_vertex_shader[] =
+    "uniform mat4 projection;                                \n"
+    "attribute vec2 a_corner;                                \n"
+    "attribute vec4 i_rect;                                  \n"
+    "attribute vec4 i_frame;                                 \n"
+    "attribute vec4 a_color;                                 \n"
+    "varying vec2 v_texCoord;                                \n"
+    "varying vec4 v_color;                                   \n"
+    "void main()                                             \n"
+    "{                                                       \n"
+    "   vec2 position = i_rect.xy + a_corner * i_rect.zw;    \n"
+    "   gl_Position = projection * vec4(position, 0.0, 1.0); \n"
+    "   v_texCoord = mix(i_frame.xy, i_frame.zw, a_corner);  \n"
+    "   v_color = a_color;                                   \n"
+    "}                                                       \n";
+
+static const char default_fragment_shader[] =
+    "#ifdef GL_ES                                                       \n"
+    "     precision lowp float;                                         \n"
+    "#endif                                                             \n"
+    "varying vec2 v_texCoord;                                           \n"
+    "varying vec4 v_color;                                              \n"
+    "uniform sampler2D s_texture;                                       \n"
+    "void main()                                                        \n"
+    "{                                                                  \n"
+    "  gl_FragColor = v_color * texture2D(s_texture, v_texCoord);       \n"
+    "}                                                                  \n";
+
+static void logShaderError(GLuint shader)
+{
+    GLint infoLen = 0;
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLen);
+
+    if(infoLen > 1)
+    {
+        auto infoLog = (char*)malloc(infoLen);
+        glGetShaderInfoLog (shader, infoLen, NULL, infoLog);
+        std::cout << infoLog << std::endl;
+        free(infoLog);
+    }
+}
+
+static void logProgramError(shader_t* shader)
+{
+    GLint infoLen = 0;
+    glGetProgramiv(shader->program, GL_INFO_LOG_LENGTH, &infoLen);
+
+    if(infoLen > 0)
+    {
+        auto infoLog = (char*)malloc(infoLen);
+        glGetProgramInfoLog(shader->program, infoLen, nullptr, infoLog);
+        std::cout << infoLog << std::endl;
+        free(infoLog);
+    }
+}
+
+static void loadShader(GLuint program, GLuint shader, const GLchar *shaderSrc) {
+    GLint compiled = 0;
+
+    glShaderSource(shader, 1, &shaderSrc, nullptr);
+    glCompileShader(shader);
+    glGetShaderiv (shader, GL_COMPILE_STATUS, &compiled);
+
+    if (compiled == GL_FALSE)
+    {
+        logShaderError(shader);
+    }
+
+    glAttachShader(program, shader);
+}
+
+static bool instancing_supported(void)
+{
+#ifdef __EMSCRIPTEN__
+    // WebGL 1 only has it as an extension.
+    return false;
+#else
+    return GLEW_VERSION_3_3;
+#endif
+}
+
+// Attribute 0 must be one read per vertex: some drivers draw nothing when
+// it is an instanced one, or one that isn't enabled.
+static int shader_create(shader_t* shader, const char* vertex_source, const char* vertex_attribute)
+{
+    GLint success = 0;
+
+    shader->program = glCreateProgram();
+    shader->vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    shader->fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+
+    loadShader(shader->program, shader->vertexShader, vertex_source);
+    loadShader(shader->program, shader->fragmentShader, default_fragment_shader);
+    glBindAttribLocation(shader->program, 0, vertex_attribute);
+    glLinkProgram(shader->program);
+    glGetProgramiv (shader->program, GL_LINK_STATUS, &success);
+
+    if (success == GL_TRUE)
+    {
+        glValidateProgram(shader->program);
+        glGetProgramiv (shader->program, GL_VALIDATE_STATUS, &success);
+    }
+
+    if (success == GL_FALSE)
+    {
+        logProgramError(shader);
+        return 0;
+    }
+
+    shader->positionLoc = glGetAttribLocation(shader->program, "position");
+    shader->texCoordLoc = glGetAttribLocation(shader->program, "a_texCoord");
+    shader->colorLoc = glGetAttribLocation(shader->program, "a_color");
+    shader->cornerLoc = glGetAttribLocation(shader->program, "a_corner");
+    shader->rectLoc = glGetAttribLocation(shader->program, "i_rect");
+    shader->frameLoc = glGetAttribLocation(shader->program, "i_frame");
+    shader->samplerLoc = glGetUniformLocation(shader->program, "s_texture" );
+    shader->projectionLoc = glGetUniformLocation(shader->program, "projection");
+    shader->attributesSet = false;
+
+    return 1;
+}
+
+int batch_begin()
+{
+    shader_t* shader = &default_shader;
+
+    instancing = instancing_supported();
+
+    bool created = instancing ? shader_create(shader, instanced_vertex_shader, "a_corner")
+                              : shader_create(shader, default_vertex_shader, "position");
+
+    if (!created)
+    {
+        return 0;
+    }
+
+    glstate_use_program(shader->program);
+
+    glGenBuffers(1, &quadObject);
+    glstate_bind_buffer(GL_ARRAY_BUFFER, quadObject);
+    glBufferData(GL_ARRAY_BUFFER, instancing ? sizeof(quads) : sizeof(vertices), nullptr, GL_STREAM_DRAW);
+
+    if (instancing)
+    {
+        // Drawn as a triangle strip.
+        static const GLfloat corners[] = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+
+        glGenBuffers(1, &cornerObject);
+        glstate_bind_buffer(GL_ARRAY_BUFFER, cornerObject);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    }
+    else
+    {
+        // The index buffer never changes: every quad is two triangles.
+        auto indices = (GLushort*)malloc(BATCH_MAX_QUADS * 6 * sizeof(GLushort));
+
+        for (int i = 0; i < BATCH_MAX_QUADS; i++)
+        {
+            indices[i * 6 + 0] = (GLushort)(i * 4 + 0);
+            indices[i * 6 + 1] = (GLushort)(i * 4 + 1);
+            indices[i * 6 + 2] = (GLushort)(i * 4 + 2);
+            indices[i * 6 + 3] = (GLushort)(i * 4 + 2);
+            indices[i * 6 + 4] = (GLushort)(i * 4 + 1);
+            indices[i * 6 + 5] = (GLushort)(i * 4 + 3);
+        }
+
+        glGenBuffers(1, &indexObject);
+        glstate_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, indexObject);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, BATCH_MAX_QUADS * 6 * sizeof(GLushort), indices, GL_STATIC_DRAW);
+
+        free(indices);
+    }
+
+    quad_count = 0;
+    current_texid = 0;
+    current_projection = nullptr;
+
+    return 1;
+}
+
+bool batch_instanced(void)
+{
+    return instancing;
+}
+
+#ifndef __EMSCRIPTEN__
+static void batch_draw_instanced(shader_t* shader)
+{
+    // Only one layout and one set of buffers exist, so the pointers never change.
+    if (!shader->attributesSet)
+    {
+        glstate_bind_buffer(GL_ARRAY_BUFFER, cornerObject);
+        glVertexAttribPointer(shader->cornerLoc, 2, GL_FLOAT, GL_FALSE, 0, (GLvoid*)0);
+
+        glstate_bind_buffer(GL_ARRAY_BUFFER, quadObject);
+        glVertexAttribPointer(shader->rectLoc, 4, GL_FLOAT, GL_FALSE, sizeof(batch_quad_t), (GLvoid*)0);
+        glVertexAttribPointer(shader->frameLoc, 4, GL_FLOAT, GL_FALSE, sizeof(batch_quad_t), (GLvoid*)(4 * sizeof(GLfloat)));
+        glVertexAttribPointer(shader->colorLoc, 4, GL_FLOAT, GL_FALSE, sizeof(batch_quad_t), (GLvoid*)(8 * sizeof(GLfloat)));
+
+        glVertexAttribDivisor(shader->rectLoc, 1);
+        glVertexAttribDivisor(shader->frameLoc, 1);
+        glVertexAttribDivisor(shader->colorLoc, 1);
+
+        shader->attributesSet = true;
+    }
+
+    glstate_enable_attrib(shader->cornerLoc);
+    glstate_enable_attrib(shader->rectLoc);
+    glstate_enable_attrib(shader->frameLoc);
+    glstate_enable_attrib(shader->colorLoc);
+
+    // Orphan the previous storage so the driver doesn't have to wait
+    // for the last draw to finish before we can write into it.
+    glstate_bind_buffer(GL_ARRAY_BUFFER, quadObject);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quads), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, quad_count * sizeof(batch_quad_t), quads);
+
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, quad_count);
+}
+#endif
+
+static void batch_draw_indexed(shader_t* shader)
+{
+    // The corners are top-left, top-right, bottom-left, bottom-right.
+    for (int i = 0; i < quad_count; i++)
+    {
+        const batch_quad_t* quad = &quads[i];
+        batch_vertex_t* v = &vertices[i * 4];
+
+        for (int corner = 0; corner < 4; corner++)
+        {
+            bool right = (corner & 1) != 0;
+            bool bottom = (corner & 2) != 0;
+
+            v[corner].x = right ? quad->x + quad->width : quad->x;
+            v[corner].y = bottom ? quad->y + quad->height : quad->y;
+            v[corner].u = right ? quad->u1 : quad->u0;
+            v[corner].v = bottom ? quad->v1 : quad->v0;
+            v[corner].r = quad->r;
+            v[corner].g = quad->g;
+            v[corner].b = quad->b;
+            v[corner].a = quad->a;
+        }
+    }
+
+    glstate_bind_buffer(GL_ARRAY_BUFFER, quadObject);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, quad_count * 4 * sizeof(batch_vertex_t), vertices);
+
+    if (!shader->attributesSet)
+    {
+        glVertexAttribPointer(shader->positionLoc, 2, GL_FLOAT, GL_FALSE, sizeof(batch_vertex_t), (GLvoid*)0);
+        glVertexAttribPointer(shader->texCoordLoc, 2, GL_FLOAT, GL_FALSE, sizeof(batch_vertex_t), (GLvoid*)(2 * sizeof(GLfloat)));
+        glVertexAttribPointer(shader->colorLoc, 4, GL_FLOAT, GL_FALSE, sizeof(batch_vertex_t), (GLvoid*)(4 * sizeof(GLfloat)));
+        shader->attributesSet = true;
+    }
+
+    glstate_enable_attrib(shader->positionLoc);
+    glstate_enable_attrib(shader->texCoordLoc);
+    glstate_enable_attrib(shader->colorLoc);
+
+    glstate_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, indexObject);
+    glDrawElements(GL_TRIANGLES, quad_count * 6, GL_UNSIGNED_SHORT, (GLvoid*)0);
+}
+
+void batch_flush()
+{
+    shader_t* shader = &default_shader;
+
+    if (quad_count == 0)
+    {
+        return;
+    }
+
+    glstate_use_program(shader->program);
+    glstate_uniform_matrix4fv(shader->projectionLoc, current_projection);
+
+    glstate_bind_texture(current_texid);
+    glstate_uniform1i(shader->samplerLoc, 0);
+
+#ifndef __EMSCRIPTEN__
+    if (instancing)
+    {
+        batch_draw_instanced(shader);
+    }
+    else
+#endif
+    {
+        batch_draw_indexed(shader);
+    }
+
+    frame_stats.draw_calls++;
+    frame_stats.quads += quad_count;
+
+    quad_count = 0;
+}
+
+void batch_quad(GLuint texid, GLfloat* projection, const batch_quad_t* quad)
+{
+    if (quad_count > 0
+        && (texid != current_texid || projection != current_projection))
+    {
+        batch_flush();
+    }
+
+    if (quad_count == BATCH_MAX_QUADS)
+    {
+        batch_flush();
+    }
+
+    current_texid = texid;
+    current_projection = projection;
+
+    quads[quad_count++] = *quad;
+}
+
+void batch_quads(GLuint texid, GLfloat* projection, const batch_quad_t* block, int count, const opengl_state_t* state)
+{
+    GLfloat scalex = state->scalex;
+    GLfloat scaley = state->scaley;
+
+    for (int i = 0; i < count; i++)
+    {
+        batch_quad_t quad = block[i];
+
+        quad.x = state->px + quad.x * scalex;
+        quad.y = state->py + quad.y * scaley;
+        quad.width *= scalex;
+        quad.height *= scaley;
+        quad.r *= state->r;
+        quad.g *= state->g;
+        quad.b *= state->b;
+        quad.a *= state->a;
+
+        batch_quad(texid, projection, &quad);
+    }
+}
+
+void batch_frame_end()
+{
+    batch_flush();
+    glstate_frame_end();
+
+    last_frame_stats = frame_stats;
+    frame_stats.draw_calls = 0;
+    frame_stats.quads = 0;
+}
+
+void batch_stats_get(batch_stats_t* stats)
+{
+    *stats = last_frame_stats;
+}
+
+void batch_finish()
+{
+    shader_t* shader = &default_shader;
+
+    glDeleteBuffers(1, &quadObject);
+
+    if (instancing)
+    {
+        glDeleteBuffers(1, &cornerObject);
+    }
+    else
+    {
+        glDeleteBuffers(1, &indexObject);
+    }
+
+    glDeleteShader(shader->fragmentShader);
+    glDeleteShader(shader->vertexShader);
+    glDeleteProgram(shader->program);
+
+    glstate_reset();
+}
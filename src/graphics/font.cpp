@@ -12,49 +12,135 @@
 #include "../include/opengl.h"
 #include "../include/texture.h"
 
+#include <vector>
+#include <cstring>
+
 #define CHARACTER_COUNT 95 // The number of printable characters in ASCII
 
-font_t* font_open(const std::string filename)
+// The number of laid out strings we keep around. A scene never shows more than a few.
+#define TEXT_CACHE_SIZE 32
+
+// The glyphs of a string, laid out once.
+struct text_t
 {
-	return (font_t*)texture_open(filename, CHARACTER_COUNT, 0.0f);
+	font_t* font;
+	std::string str;
+	texture_mesh_t* mesh;
+	std::vector<int> glyph_count; // glyph_count[i]: glyphs in the first i characters
+	unsigned int last_used;
+};
+
+static text_t text_cache[TEXT_CACHE_SIZE];
+static unsigned int text_clock;
+
+static void text_layout(text_t* text)
+{
+	auto texture = (texture_t*)text->font;
+	int x = 0, y = 0;
+
+	text->mesh = texture_mesh_create(texture);
+	text->glyph_count.resize(text->str.length() + 1);
+	text->glyph_count[0] = 0;
+
+	for (size_t i = 0; i < text->str.length(); i++)
+	{
+		if (text->str[i] == '\n')
+		{
+			x = 0;
+			y += texture_frame_height(texture) + 2;
+		}
+
+		int frame = text->str[i] - ' ';
+
+		if (frame >= 0 && frame < CHARACTER_COUNT)
+		{
+			texture_mesh_add(text->mesh, x, y, frame);
+			x += texture_frame_width(texture);
+		}
+
+		text->glyph_count[i + 1] = texture_mesh_size(text->mesh);
+	}
 }
 
-void font_render(font_t* font, const std::string str)
+static void text_clear(text_t* text)
 {
-	font_render(font, str, str.length());
+	if (text->mesh != nullptr)
+	{
+		texture_mesh_close(text->mesh);
+	}
+
+	text->font = nullptr;
+	text->mesh = nullptr;
+	text->str.clear();
+	text->glyph_count.clear();
 }
 
-void font_render(font_t* font, const std::string str, int charcount)
+// Returns the layout of the string, building it if it isn't cached.
+static text_t* text_get(font_t* font, const char* str)
 {
-	auto texture = (texture_t*)font;
-    opengl_state_t state;
-	int height = 0;
+	text_t* oldest = &text_cache[0];
 
-    opengl_save(&state);
+	text_clock++;
 
-	for (int i = 0; i < charcount; i++)
-    {
-		if (str[i] == '\n')
+	for (int i = 0; i < TEXT_CACHE_SIZE; i++)
+	{
+		text_t* text = &text_cache[i];
+
+		if (text->font == font && strcmp(text->str.c_str(), str) == 0)
 		{
-			opengl_restore(&state);
-			height += texture_frame_height(texture) + 2;
-			opengl_move(0, height);
+			text->last_used = text_clock;
+			return text;
 		}
 
-        int frame = str[i] - ' ';
+		if (text->last_used < oldest->last_used)
+		{
+			oldest = text;
+		}
+	}
+
+	text_clear(oldest);
+
+	oldest->font = font;
+	oldest->str = str;
+	oldest->last_used = text_clock;
+	text_layout(oldest);
+
+	return oldest;
+}
 
-        if (frame >= 0 && frame < CHARACTER_COUNT)
-        {
-            opengl_texture(texture, frame);
-            opengl_move(texture_frame_width(texture), 0.0f);
-        }
-    }
+font_t* font_open(const std::string filename)
+{
+	return (font_t*)texture_open(filename, CHARACTER_COUNT, 0.0f);
+}
 
-    opengl_restore(&state);
+void font_render(font_t* font, const char* str)
+{
+	font_render(font, str, (int)strlen(str));
+}
+
+void font_render(font_t* font, const char* str, int charcount)
+{
+	text_t* text = text_get(font, str);
+
+	if (charcount > (int)text->str.length())
+	{
+		charcount = (int)text->str.length();
+	}
+
+	// Partially displayed strings (dialogs) share the layout of the whole string.
+	opengl_mesh(text->mesh, text->glyph_count[charcount]);
 }
 
 void font_close(font_t* font)
 {
+	for (int i = 0; i < TEXT_CACHE_SIZE; i++)
+	{
+		if (text_cache[i].font == font)
+		{
+			text_clear(&text_cache[i]);
+		}
+	}
+
 	texture_close((texture_t*)font);
 }
 
@@ -64,8 +150,8 @@ int font_height(font_t* font)
 	return texture_frame_height(texture);
 }
 
-int font_width(font_t* font, const std::string str)
+int font_width(font_t* font, const char* str)
 {
 	auto texture = (texture_t*)font;
-	return texture_frame_width(texture) * str.length();
-}
\ No newline at end of file
+	return texture_frame_width(texture) * (int)strlen(str);
+}
@@ -0,0 +1,274 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+#include <GL/glew.h>
+
+#include "../include/glstate.h"
+
+#include <cstring>
+
+#define GLSTATE_MAX_UNIFORMS 32
+#define GLSTATE_MAX_ATTRIBS 32
+
+// Last value sent to a uniform location of a program.
+struct uniform_t
+{
+    GLuint program;
+    GLint location;
+    GLfloat values[16];
+};
+
+struct state_t
+{
+    GLuint program;
+    GLuint texture;
+    GLuint array_buffer, element_buffer;
+    GLuint framebuffer;
+    unsigned int enabled_attribs; // one bit per attribute index
+
+    bool scissor_enabled;
+    int scissor_x, scissor_y, scissor_width, scissor_height;
+
+    uniform_t uniforms[GLSTATE_MAX_UNIFORMS];
+    int uniform_count;
+};
+
+static state_t current;
+static glstate_stats_t frame_stats, last_frame_stats;
+
+void glstate_reset()
+{
+    // The GL defaults, which we never rely on: the first call always goes through.
+    memset(&current, 0, sizeof(current));
+    current.program = (GLuint)-1;
+    current.texture = (GLuint)-1;
+    current.array_buffer = (GLuint)-1;
+    current.element_buffer = (GLuint)-1;
+    current.framebuffer = (GLuint)-1;
+    current.scissor_width = -1;
+}
+
+// Returns the cached slot for the location, or nullptr if the value is unknown yet.
+static uniform_t* uniform_get(GLint location, bool create)
+{
+    for (int i = 0; i < current.uniform_count; i++)
+    {
+        uniform_t* uniform = &current.uniforms[i];
+
+        if (uniform->program == current.program && uniform->location == location)
+        {
+            return uniform;
+        }
+    }
+
+    if (!create || current.uniform_count == GLSTATE_MAX_UNIFORMS)
+    {
+        return nullptr;
+    }
+
+    uniform_t* uniform = &current.uniforms[current.uniform_count++];
+    uniform->program = current.program;
+    uniform->location = location;
+
+    return uniform;
+}
+
+void glstate_use_program(GLuint program)
+{
+    if (current.program == program)
+    {
+        frame_stats.skipped++;
+        return;
+    }
+
+    glUseProgram(program);
+    current.program = program;
+    frame_stats.issued++;
+}
+
+void glstate_bind_texture(GLuint texture)
+{
+    if (current.texture == texture)
+    {
+        frame_stats.skipped++;
+        return;
+    }
+
+    // We only ever use the first texture unit.
+    if (current.texture == (GLuint)-1)
+    {
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    current.texture = texture;
+    frame_stats.issued++;
+    frame_stats.texture_binds++;
+}
+
+void glstate_bind_buffer(GLenum target, GLuint buffer)
+{
+    GLuint* bound = target == GL_ELEMENT_ARRAY_BUFFER ? &current.element_buffer : &current.array_buffer;
+
+    if (*bound == buffer)
+    {
+        frame_stats.skipped++;
+        return;
+    }
+
+    glBindBuffer(target, buffer);
+    *bound = buffer;
+    frame_stats.issued++;
+}
+
+void glstate_bind_framebuffer(GLuint framebuffer)
+{
+    if (current.framebuffer == framebuffer)
+    {
+        frame_stats.skipped++;
+        return;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    current.framebuffer = framebuffer;
+    frame_stats.issued++;
+}
+
+void glstate_enable_attrib(GLuint index)
+{
+    // Also -1, from glGetAttribLocation for an attribute the shader lacks.
+    if (index >= GLSTATE_MAX_ATTRIBS)
+    {
+        return;
+    }
+
+    unsigned int bit = 1u << index;
+
+    if (current.enabled_attribs & bit)
+    {
+        frame_stats.skipped++;
+        return;
+    }
+
+    glEnableVertexAttribArray(index);
+    current.enabled_attribs |= bit;
+    frame_stats.issued++;
+}
+
+void glstate_uniform1i(GLint location, GLint value)
+{
+    uniform_t* uniform = uniform_get(location, false);
+
+    if (uniform != nullptr && uniform->values[0] == (GLfloat)value)
+    {
+        frame_stats.skipped++;
+        return;
+    }
+
+    glUniform1i(location, value);
+    frame_stats.issued++;
+
+    if ((uniform = uniform_get(location, true)) != nullptr)
+    {
+        uniform->values[0] = (GLfloat)value;
+    }
+}
+
+void glstate_uniform_matrix4fv(GLint location, const GLfloat* value)
+{
+    uniform_t* uniform = uniform_get(location, false);
+
+    if (uniform != nullptr && memcmp(uniform->values, value, sizeof(uniform->values)) == 0)
+    {
+        frame_stats.skipped++;
+        return;
+    }
+
+    glUniformMatrix4fv(location, 1, GL_FALSE, value);
+    frame_stats.issued++;
+
+    if ((uniform = uniform_get(location, true)) != nullptr)
+    {
+        memcpy(uniform->values, value, sizeof(uniform->values));
+    }
+}
+
+bool glstate_scissor_is(bool enabled, int x, int y, int width, int height)
+{
+    if (!enabled)
+    {
+        return !current.scissor_enabled && current.scissor_width != -1;
+    }
+
+    return current.scissor_enabled
+        && current.scissor_x == x
+        && current.scissor_y == y
+        && current.scissor_width == width
+        && current.scissor_height == height;
+}
+
+void glstate_scissor(bool enabled, int x, int y, int width, int height)
+{
+    if (glstate_scissor_is(enabled, x, y, width, height))
+    {
+        frame_stats.skipped++;
+        return;
+    }
+
+    if (!enabled)
+    {
+        glDisable(GL_SCISSOR_TEST);
+        current.scissor_enabled = false;
+        current.scissor_width = 0;
+        frame_stats.issued++;
+        return;
+    }
+
+    if (!current.scissor_enabled)
+    {
+        glEnable(GL_SCISSOR_TEST);
+        current.scissor_enabled = true;
+        frame_stats.issued++;
+    }
+
+    glScissor(x, y, (GLsizei)width, (GLsizei)height);
+    current.scissor_x = x;
+    current.scissor_y = y;
+    current.scissor_width = width;
+    current.scissor_height = height;
+    frame_stats.issued++;
+}
+
+void glstate_delete_textures(GLsizei count, const GLuint* textures)
+{
+    // GL unbinds a texture when it is deleted.
+    for (GLsizei i = 0; i < count; i++)
+    {
+        if (textures[i] == current.texture)
+        {
+            current.texture = 0;
+        }
+    }
+
+    glDeleteTextures(count, textures);
+}
+
+void glstate_frame_end()
+{
+    last_frame_stats = frame_stats;
+    frame_stats.issued = 0;
+    frame_stats.skipped = 0;
+    frame_stats.texture_binds = 0;
+}
+
+void glstate_stats_get(glstate_stats_t* stats)
+{
+    *stats = last_frame_stats;
+}
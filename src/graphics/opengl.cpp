@@ -14,14 +14,24 @@
 #include "../include/opengl.h"
 #include "../include/window.h"
 #include "../include/texture.h"
+#include "../include/batch.h"
+#include "../include/glstate.h"
+#include "../include/software.h"
 
 #include <iostream>
 #include <cstring>
 
-static GLfloat projection[16];
+static GLfloat window_projection[16], native_projection[16];
+static GLfloat* projection = window_projection; // the one of the current target
 static opengl_state_t current_state;
 static texture_t* rectangle_texture;
 
+// When set, frames are drawn at the reference size into this texture,
+// which is then scaled to the window in one draw.
+static texture_t* offscreen_target;
+
+static bool software;
+
 #ifdef DEBUG
 #define check_gl_error() logOpenGLError(__FILE__,__LINE__)
 
@@ -130,6 +140,8 @@ int opengl_begin()
 		return 0;
 	}
 
+    glstate_reset();
+
     // A colored rectangle is equivalent to a scaled colored one-pixel texture.
     unsigned char white_texture[] = { 255, 255, 255, 255 };
     rectangle_texture = texture_from_bytes(white_texture, 1, 1);
@@ -137,33 +149,100 @@ int opengl_begin()
 	return 1;
 }
 
+int opengl_offscreen_enable(void)
+{
+    offscreen_target = texture_target_create(REFERENCE_WIDTH, REFERENCE_HEIGHT);
+
+    if (offscreen_target == nullptr)
+    {
+        return 0;
+    }
+
+    opengl_projection(native_projection, REFERENCE_WIDTH, REFERENCE_HEIGHT);
+    return 1;
+}
+
+bool opengl_offscreen_enabled(void)
+{
+    return offscreen_target != nullptr || software;
+}
+
+int opengl_software_begin()
+{
+    if (!software_begin(REFERENCE_WIDTH, REFERENCE_HEIGHT))
+    {
+        std::cout << "Failed to allocate the software framebuffer." << std::endl;
+        return 0;
+    }
+
+    software = true;
+
+    unsigned char white_texture[] = { 255, 255, 255, 255 };
+    rectangle_texture = texture_from_bytes(white_texture, 1, 1);
+
+    return 1;
+}
+
+bool opengl_software_enabled(void)
+{
+    return software;
+}
+
 void opengl_finish()
 {
+    texture_close(offscreen_target);
     texture_close(rectangle_texture);
+
+    if (software)
+    {
+        software_finish();
+    }
 }
 
 void opengl_scissor_enable(int x, int y, int width, int height)
 {
-    glEnable(GL_SCISSOR_TEST);
-    glScissor(x, y, (GLsizei) width, (GLsizei) height);
+    if (software)
+    {
+        software_scissor_enable(x, y, width, height);
+        return;
+    }
+
+    // Only break the batch if the scissor box actually changes.
+    if (!glstate_scissor_is(true, x, y, width, height))
+    {
+        batch_flush();
+        glstate_scissor(true, x, y, width, height);
+    }
 }
 
 void opengl_scissor_disable()
 {
-    glDisable(GL_SCISSOR_TEST);
+    if (software)
+    {
+        software_scissor_disable();
+        return;
+    }
+
+    if (!glstate_scissor_is(false, 0, 0, 0, 0))
+    {
+        batch_flush();
+        glstate_scissor(false, 0, 0, 0, 0);
+    }
 }
 
 static void opengl_reset(
         unsigned int wx,
         unsigned int wy)
 {
+    batch_flush();
+
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glDisable(GL_DEPTH_TEST);
 
     glViewport(0, 0, (GLsizei) wx, (GLsizei) wy);
 
-    opengl_projection(projection, window_width_get(), window_height_get());
+    opengl_projection(window_projection, window_width_get(), window_height_get());
 
     //check_gl_error();
 }
@@ -179,10 +258,86 @@ void opengl_clear(void)
     current_state.scalex = 1.0f;
     current_state.scaley = 1.0f;
 
+    if (software)
+    {
+        software_clear(0, 0, 0);
+        return;
+    }
+
     if(window_was_reset())
     {
         opengl_reset(window_width_get(), window_height_get());
     }
+
+    if (offscreen_target != nullptr)
+    {
+        texture_target_bind(offscreen_target);
+        glViewport(0, 0, REFERENCE_WIDTH, REFERENCE_HEIGHT);
+        projection = native_projection;
+
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+}
+
+// Scale the offscreen frame to the window by the largest integer factor
+// that fits, and fill the remaining border.
+static void opengl_present(void)
+{
+    int window_width = window_width_get();
+    int window_height = window_height_get();
+
+    int zoom = window_width / REFERENCE_WIDTH;
+
+    if (window_height / REFERENCE_HEIGHT < zoom)
+    {
+        zoom = window_height / REFERENCE_HEIGHT;
+    }
+
+    if (zoom < 1)
+    {
+        zoom = 1;
+    }
+
+    texture_target_bind(nullptr);
+    glViewport(0, 0, (GLsizei) window_width, (GLsizei) window_height);
+    projection = window_projection;
+
+    opengl_scissor_disable();
+    glClearColor(0.05f, 0.05f, 0.1f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    current_state.px = (window_width - REFERENCE_WIDTH * zoom) / 2;
+    current_state.py = (window_height - REFERENCE_HEIGHT * zoom) / 2;
+    current_state.r = 1.0f;
+    current_state.g = 1.0f;
+    current_state.b = 1.0f;
+    current_state.a = 1.0f;
+    current_state.scalex = zoom;
+    current_state.scaley = zoom;
+
+    // The alpha of the frame is meaningless, it must not be blended.
+    glDisable(GL_BLEND);
+    texture_render(offscreen_target, 0, projection, &current_state);
+    batch_flush();
+    glEnable(GL_BLEND);
+}
+
+void opengl_flush(void)
+{
+    if (software)
+    {
+        software_frame_end();
+        window_present(software_pixels(), software_width(), software_height());
+        return;
+    }
+
+    if (offscreen_target != nullptr)
+    {
+        opengl_present();
+    }
+
+    batch_frame_end();
 }
 
 void opengl_rectangle(int width, int height)
@@ -201,3 +356,8 @@ void opengl_texture(texture_t* texture, int frame_current)
 {
     texture_render(texture, frame_current, projection, &current_state);
 }
+
+void opengl_mesh(texture_mesh_t* mesh, int count)
+{
+    texture_mesh_render(mesh, count, projection, &current_state);
+}
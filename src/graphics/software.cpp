@@ -0,0 +1,353 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+#include "../include/software.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOFTWARE_SSE2
+#include <emmintrin.h>
+#endif
+
+// AVX2 is chosen at runtime, so it needs the compiler to build single functions for it.
+#if defined(SOFTWARE_SSE2) && defined(__GNUC__)
+#define SOFTWARE_AVX2
+#include <immintrin.h>
+#endif
+
+// Blend 'count' source pixels into the destination. The color is 4 values from 0 to 255.
+typedef void (*blend_span_t)(unsigned char* dst, const unsigned char* src, int count, const unsigned short* color);
+
+static unsigned char* framebuffer;
+static int framebuffer_width, framebuffer_height;
+
+static bool scissor_enabled;
+static int scissor_x0, scissor_y0, scissor_x1, scissor_y1;
+
+static blend_span_t blend_span;
+static std::vector<unsigned char> expanded; // one row of a horizontally scaled image
+
+static FILE* capture;
+
+//
+// All versions compute exactly the same values:
+// m = texel * color, then dst = m * m.a + dst * (1 - m.a), like
+// glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA) does, for all 4 channels.
+//
+
+// x * y / 255, correctly rounded, for x and y from 0 to 255.
+static inline unsigned int mul255(unsigned int x, unsigned int y)
+{
+    unsigned int t = x * y + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+static void blend_span_scalar(unsigned char* dst, const unsigned char* src, int count, const unsigned short* color)
+{
+    for (int i = 0; i < count; i++, dst += 4, src += 4)
+    {
+        unsigned int m[4];
+
+        for (int c = 0; c < 4; c++)
+        {
+            m[c] = mul255(src[c], color[c]);
+        }
+
+        unsigned int a = m[3];
+
+        for (int c = 0; c < 4; c++)
+        {
+            dst[c] = (unsigned char)(mul255(m[c], a) + mul255(dst[c], 255 - a));
+        }
+    }
+}
+
+#ifdef SOFTWARE_SSE2
+// The products fit in 16 bits, so 8 channels (2 pixels) are handled at once.
+static inline __m128i mul255_sse2(__m128i x, __m128i y)
+{
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(x, y), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+static inline __m128i blend_sse2(__m128i src, __m128i dst, __m128i color)
+{
+    __m128i m = mul255_sse2(src, color);
+    __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(m, 0xFF), 0xFF);
+    __m128i inv = _mm_sub_epi16(_mm_set1_epi16(255), a);
+
+    return _mm_add_epi16(mul255_sse2(m, a), mul255_sse2(dst, inv));
+}
+
+static void blend_span_sse2(unsigned char* dst, const unsigned char* src, int count, const unsigned short* color)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i c = _mm_set_epi16(
+            color[3], color[2], color[1], color[0],
+            color[3], color[2], color[1], color[0]);
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i * 4));
+
+        __m128i lo = blend_sse2(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero), c);
+        __m128i hi = blend_sse2(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero), c);
+
+        _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_packus_epi16(lo, hi));
+    }
+
+    blend_span_scalar(dst + i * 4, src + i * 4, count - i, color);
+}
+#endif
+
+#ifdef SOFTWARE_AVX2
+// Same as SSE2 on 8 pixels. Unpack and pack work within each 128 bits half,
+// so the pixels come back in the right order.
+__attribute__((target("avx2")))
+static inline __m256i mul255_avx2(__m256i x, __m256i y)
+{
+    __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(x, y), _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i blend_avx2(__m256i src, __m256i dst, __m256i color)
+{
+    __m256i m = mul255_avx2(src, color);
+    __m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(m, 0xFF), 0xFF);
+    __m256i inv = _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+
+    return _mm256_add_epi16(mul255_avx2(m, a), mul255_avx2(dst, inv));
+}
+
+__attribute__((target("avx2")))
+static void blend_span_avx2(unsigned char* dst, const unsigned char* src, int count, const unsigned short* color)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i c = _mm256_set_epi16(
+            color[3], color[2], color[1], color[0],
+            color[3], color[2], color[1], color[0],
+            color[3], color[2], color[1], color[0],
+            color[3], color[2], color[1], color[0]);
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i s = _mm256_loadu_si256((const __m256i*)(src + i * 4));
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i * 4));
+
+        __m256i lo = blend_avx2(_mm256_unpacklo_epi8(s, zero), _mm256_unpacklo_epi8(d, zero), c);
+        __m256i hi = blend_avx2(_mm256_unpackhi_epi8(s, zero), _mm256_unpackhi_epi8(d, zero), c);
+
+        _mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_packus_epi16(lo, hi));
+    }
+
+    blend_span_sse2(dst + i * 4, src + i * 4, count - i, color);
+}
+#endif
+
+static blend_span_t blend_span_select(void)
+{
+#ifdef SOFTWARE_AVX2
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return blend_span_avx2;
+    }
+#endif
+
+#ifdef SOFTWARE_SSE2
+    return blend_span_sse2;
+#else
+    return blend_span_scalar;
+#endif
+}
+
+int software_begin(int width, int height)
+{
+    framebuffer = (unsigned char*)calloc((size_t)width * height, 4);
+
+    if (framebuffer == nullptr)
+    {
+        return 0;
+    }
+
+    framebuffer_width = width;
+    framebuffer_height = height;
+    scissor_enabled = false;
+    blend_span = blend_span_select();
+
+    return 1;
+}
+
+void software_finish()
+{
+    if (capture != nullptr)
+    {
+        fclose(capture);
+        capture = nullptr;
+    }
+
+    free(framebuffer);
+    framebuffer = nullptr;
+}
+
+int software_capture_open(const std::string filename)
+{
+    if ((capture = fopen(filename.c_str(), "wb")) == nullptr)
+    {
+        std::cout << "Could not open '" << filename << "' for the capture." << std::endl;
+        return 0;
+    }
+
+    std::cout << "Capturing " << framebuffer_width << "x" << framebuffer_height
+              << " RGBA frames to " << filename << std::endl;
+
+    return 1;
+}
+
+void software_clear(unsigned char r, unsigned char g, unsigned char b)
+{
+    unsigned char pixel[4] = { r, g, b, 255 };
+    int count = framebuffer_width * framebuffer_height;
+
+    for (int i = 0; i < count; i++)
+    {
+        memcpy(framebuffer + i * 4, pixel, 4);
+    }
+}
+
+void software_scissor_enable(int x, int y, int width, int height)
+{
+    scissor_enabled = true;
+    scissor_x0 = x;
+    scissor_x1 = x + width;
+    scissor_y0 = framebuffer_height - (y + height);
+    scissor_y1 = framebuffer_height - y;
+}
+
+void software_scissor_disable()
+{
+    scissor_enabled = false;
+}
+
+static unsigned short color_byte(float c)
+{
+    if (c <= 0.0f)
+        return 0;
+
+    if (c >= 1.0f)
+        return 255;
+
+    return (unsigned short)(c * 255.0f + 0.5f);
+}
+
+void software_blit(
+        const unsigned char* pixels, int pitch,
+        int sx, int sy, int sw, int sh,
+        int dx, int dy, int scalex, int scaley,
+        float r, float g, float b, float a)
+{
+    if (scalex <= 0 || scaley <= 0)
+    {
+        return;
+    }
+
+    int x0 = dx, y0 = dy;
+    int x1 = dx + sw * scalex, y1 = dy + sh * scaley;
+
+    int clip_x0 = 0, clip_y0 = 0;
+    int clip_x1 = framebuffer_width, clip_y1 = framebuffer_height;
+
+    if (scissor_enabled)
+    {
+        if (scissor_x0 > clip_x0) clip_x0 = scissor_x0;
+        if (scissor_y0 > clip_y0) clip_y0 = scissor_y0;
+        if (scissor_x1 < clip_x1) clip_x1 = scissor_x1;
+        if (scissor_y1 < clip_y1) clip_y1 = scissor_y1;
+    }
+
+    if (x0 < clip_x0) x0 = clip_x0;
+    if (y0 < clip_y0) y0 = clip_y0;
+    if (x1 > clip_x1) x1 = clip_x1;
+    if (y1 > clip_y1) y1 = clip_y1;
+
+    if (x0 >= x1 || y0 >= y1)
+    {
+        return;
+    }
+
+    unsigned short color[4] = { color_byte(r), color_byte(g), color_byte(b), color_byte(a) };
+    int expanded_row = -1;
+
+    if (scalex != 1)
+    {
+        expanded.resize((size_t)(x1 - x0) * 4);
+    }
+
+    for (int y = y0; y < y1; y++)
+    {
+        int row = sy + (y - dy) / scaley;
+        const unsigned char* source = pixels + ((size_t)row * pitch + sx) * 4;
+        const unsigned char* span;
+
+        if (scalex == 1)
+        {
+            span = source + (x0 - dx) * 4;
+        }
+        else
+        {
+            // Repeat each texel horizontally once per source row, and reuse
+            // the result for the scaley destination rows it covers.
+            if (row != expanded_row)
+            {
+                for (int x = x0; x < x1; x++)
+                {
+                    memcpy(&expanded[(x - x0) * 4], source + ((x - dx) / scalex) * 4, 4);
+                }
+
+                expanded_row = row;
+            }
+
+            span = expanded.data();
+        }
+
+        blend_span(framebuffer + ((size_t)y * framebuffer_width + x0) * 4, span, x1 - x0, color);
+    }
+}
+
+void software_frame_end()
+{
+    if (capture != nullptr)
+    {
+        fwrite(framebuffer, 4, (size_t)framebuffer_width * framebuffer_height, capture);
+    }
+}
+
+const unsigned char* software_pixels()
+{
+    return framebuffer;
+}
+
+int software_width()
+{
+    return framebuffer_width;
+}
+
+int software_height()
+{
+    return framebuffer_height;
+}
@@ -11,26 +11,35 @@
 #include <GL/glew.h>
 
 #include "../include/texture.h"
+#include "../include/batch.h"
+#include "../include/atlas.h"
+#include "../include/glstate.h"
+#include "../include/software.h"
+#include "../include/trace.h"
+#include "../include/cache.h"
+#include "../include/pack.h"
+#include "../include/file.h"
+#include "../include/pool.h"
+#include "../include/arena.h"
 #include "lodepng/lodepng.h"
 
+#include <condition_variable>
 #include <iostream>
+#include <cstring>
+#include <mutex>
+#include <vector>
 
 //#define DEBUG_TEXTURE
 
-struct shader_t
-{
-    GLuint program, vertexShader, fragmentShader;
-    GLint positionLoc, texCoordLoc, samplerLoc, lightLoc, projectionLoc;
-    GLuint vertexObject, indexObject;
-    GLfloat vertices[16]; // 4 vertices x (2 position coordinates + 2 texture coordinate
-};
-
 struct texture_t
 {
     int frame_count; // the frame counts for animation
     float frame_duration;
 
-    GLuint texid; // the opengl texture id
+    atlas_region_t region; // where the pixels are, either in an atlas page or in their own texture
+    bool atlased;
+    GLuint framebuffer; // only for render targets
+    unsigned char* pixels; // only with the software renderer
 
     int width; // the texture size
     int height;
@@ -40,194 +49,92 @@ struct texture_t
 #endif
 };
 
-static shader_t default_shader;
-
-static const char default_vertex_shader[] =
-    "uniform mat4 projection;                                \n"
-    "attribute vec2 position;                                \n"
-    "attribute vec2 a_texCoord;                              \n"
-    "varying vec2 v_texCoord;                                \n"
-    "void main()                                             \n"
-    "{                                                       \n"
-    "   gl_Position = projection * vec4(position, 0.0, 1.0); \n"
-    "   v_texCoord = a_texCoord;                             \n"
-    "}                                                       \n";
-
-static const char default_fragment_shader[] =
-    "#ifdef GL_ES                                                       \n"
-    "     precision lowp float;                                         \n"
-    "#endif                                                             \n"
-    "varying vec2 v_texCoord;                                           \n"
-    "uniform sampler2D s_texture;                                       \n"
-    "uniform vec4 s_light;                                              \n"
-    "void main()                                                        \n"
-    "{                                                                  \n"
-    "  gl_FragColor = s_light * texture2D(s_texture, v_texCoord);       \n"
-    "}                                                                  \n";
-
-static int texture_count = 0;
-
-static void logShaderError(GLuint shader)
-{
-    GLint infoLen = 0;
-    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLen);
+// Decodes the files of texture_open_batch, a thread per core.
+static pool_t* decode_pool = nullptr;
 
-    if(infoLen > 1)
-    {
-        auto infoLog = (char*)malloc(infoLen);
-        glGetShaderInfoLog (shader, infoLen, NULL, infoLog);
-        std::cout << infoLog << std::endl;
-        free(infoLog);
-    }
-}
+struct texture_batch_t
+{
+    std::mutex mutex;
+    std::condition_variable decoded;
+};
 
-static void logProgramError(shader_t* shader)
+struct texture_batch_file_t
 {
-    GLint infoLen = 0;
-    glGetProgramiv(shader->program, GL_INFO_LOG_LENGTH, &infoLen);
+    texture_batch_t* batch;
+    std::string filename;
 
-    if(infoLen > 0)
-    {
-        auto infoLog = (char*)malloc(infoLen);
-        glGetProgramInfoLog(shader->program, infoLen, nullptr, infoLog);
-        std::cout << infoLog << std::endl;
-        free(infoLog);
-    }
-}
+    arena_t* arena;
+    unsigned char* image; // nullptr if it failed
+    int width, height;
+    bool done; // under the mutex of the batch
+};
 
-static void loadShader(GLuint program, GLuint shader, const GLchar *shaderSrc) {
-    GLint compiled = 0;
+struct texture_mesh_t
+{
+    texture_t* texture;
+    std::vector<batch_quad_t> quads; // relative, white
+    std::vector<int> frames; // for the software renderer
+};
 
-    glShaderSource(shader, 1, &shaderSrc, nullptr);
-    glCompileShader(shader);
-    glGetShaderiv (shader, GL_COMPILE_STATUS, &compiled);
+int texture_begin()
+{
+#ifndef __EMSCRIPTEN__
+    decode_pool = pool_create(0);
+#endif
 
-    if (compiled == GL_FALSE)
+    if (opengl_software_enabled())
     {
-        logShaderError(shader);
+        return 1;
     }
 
-    glAttachShader(program, shader);
+    return batch_begin();
 }
 
-int texture_begin()
+void texture_render(texture_t* texture, int frame_current, GLfloat* projection, opengl_state_t* state)
 {
-    GLint success = 0;
-	shader_t* shader = &default_shader;
-
-    shader->program = glCreateProgram();
-    shader->vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    shader->fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-
-    loadShader(shader->program, shader->vertexShader, default_vertex_shader);
-    loadShader(shader->program, shader->fragmentShader, default_fragment_shader);
-    glLinkProgram(shader->program);
-    glGetProgramiv (shader->program, GL_LINK_STATUS, &success);
-
-    if (success == GL_TRUE)
-    {
-        glValidateProgram(shader->program);
-        glGetProgramiv (shader->program, GL_VALIDATE_STATUS, &success);
-    }
-
-    if (success == GL_FALSE)
+    if (texture->pixels != nullptr)
     {
-        logProgramError(shader);
-        return 0;
+        int frame_width = texture_frame_width(texture);
+
+        software_blit(
+                texture->pixels, texture->width,
+                frame_current * frame_width, 0, frame_width, texture->height,
+                state->px, state->py, state->scalex, state->scaley,
+                state->r, state->g, state->b, state->a);
+        return;
     }
 
-    glUseProgram(shader->program);
+    batch_quad_t quad;
 
-    shader->positionLoc = glGetAttribLocation(shader->program, "position");
-    shader->texCoordLoc = glGetAttribLocation(shader->program, "a_texCoord");
-    shader->samplerLoc = glGetUniformLocation(shader->program, "s_texture" );
-    shader->lightLoc = glGetUniformLocation(shader->program, "s_light" );
-    shader->projectionLoc = glGetUniformLocation(shader->program, "projection");
+    // The frames are laid out horizontally inside the texture's region.
+    atlas_region_t* region = &texture->region;
+    GLfloat frame_width = (region->u1 - region->u0) / texture->frame_count;
 
-    glGenBuffers(1, &shader->vertexObject);
-    glBindBuffer(GL_ARRAY_BUFFER, shader->vertexObject);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(shader->vertices), shader->vertices, GL_DYNAMIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    quad.x = state->px;
+    quad.y = state->py;
+    quad.width = texture_frame_width(texture) * state->scalex;
+    quad.height = texture_frame_height(texture) * state->scaley;
 
-    static GLushort indices[] = { 0, 1, 2, 2, 1, 3 };
+    quad.u0 = region->u0 + frame_width * frame_current;
+    quad.v0 = region->v0;
+    quad.u1 = quad.u0 + frame_width;
+    quad.v1 = region->v1;
 
-    glGenBuffers(1, &shader->indexObject);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, shader->indexObject);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    quad.r = state->r;
+    quad.g = state->g;
+    quad.b = state->b;
+    quad.a = state->a;
 
-    return 1;
+    batch_quad(region->texid, projection, &quad);
 }
 
-void texture_render(texture_t* texture, int frame_current, GLfloat* projection, opengl_state_t* state)
-{
-    shader_t* shader = &default_shader;
-
-    GLfloat left, right, width, height;
-    GLfloat scalex = state->scalex;
-    GLfloat scaley = state->scaley;
-
-    glUseProgram(shader->program);
-
-    glUniformMatrix4fv(shader->projectionLoc, 1, GL_FALSE, projection);
-
-    width = (GLfloat)texture_frame_width(texture);
-    height = (GLfloat)texture_frame_height(texture);
-    left = (GLfloat) frame_current / texture->frame_count;
-    right = (GLfloat) (frame_current + 1) / texture->frame_count;
-
-    shader->vertices[0] = state->px; // position 0
-    shader->vertices[1] = state->py;
-    shader->vertices[4] = state->px + width * scalex; // position 1
-    shader->vertices[5] = state->py;
-    shader->vertices[8] = state->px; // position 2
-    shader->vertices[9] = state->py + height * scaley;
-    shader->vertices[12] = state->px + width * scalex; // position 3
-    shader->vertices[13] = state->py + height * scaley;
-
-    shader->vertices[2] = left; // texture 0
-    shader->vertices[3] = 0.0f;
-    shader->vertices[6] = right; // texture 1
-    shader->vertices[7] = 0.0f;
-    shader->vertices[10] = left; // texture 2
-    shader->vertices[11] = 1.0f;
-    shader->vertices[14] = right; // texture 3
-    shader->vertices[15] = 1.0f;
-
-    glBindBuffer(GL_ARRAY_BUFFER, shader->vertexObject);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(shader->vertices), shader->vertices);
-    glVertexAttribPointer(shader->positionLoc, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (GLvoid*)0);
-    glVertexAttribPointer(shader->texCoordLoc, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (GLvoid*)(2 * sizeof(GLfloat)));
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    glEnableVertexAttribArray(shader->positionLoc);
-    glEnableVertexAttribArray(shader->texCoordLoc);
-
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture->texid);
-    glUniform1i(shader->samplerLoc, 0);
-
-    glUniform4f(shader->lightLoc, state->r, state->g, state->b, state->a);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, shader->indexObject);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (GLvoid*)0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-}
-
-static void shader_close(shader_t* shader)
-{
-    glDeleteShader(shader->fragmentShader);
-    glDeleteShader(shader->vertexShader);
-    glDeleteShader(shader->program);
-}
-
-static GLuint opengl_load(unsigned char* image, unsigned width, unsigned height)
+static GLuint opengl_load(const unsigned char* image, unsigned width, unsigned height)
 {
     GLuint texid;
     int pack, unpack;
 
     glGenTextures(1, &texid);
-    glBindTexture(GL_TEXTURE_2D, texid);
+    glstate_bind_texture(texid);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -253,85 +160,479 @@ static GLuint opengl_load(unsigned char* image, unsigned width, unsigned height)
 
     glPixelStorei(GL_PACK_ALIGNMENT, pack);
     glPixelStorei(GL_UNPACK_ALIGNMENT, unpack);
-    glBindTexture(GL_TEXTURE_2D, 0);
 
     return texid;
 }
 
-texture_t* texture_from_bytes(unsigned char* bytes, int width, int height)
+// Place the image in an atlas page if possible, in its own texture otherwise.
+static texture_t* texture_create(const unsigned char* image, int width, int height, int frame_count, float frame_duration)
 {
-    GLuint texid = opengl_load(bytes, width, height);
+    auto texture = new texture_t;
+
+    texture->pixels = nullptr;
+    texture->atlased = false;
+
+    if (opengl_software_enabled())
+    {
+        // The software renderer reads the pixels directly.
+        texture->pixels = (unsigned char*)malloc((size_t)width * height * 4);
+        memcpy(texture->pixels, image, (size_t)width * height * 4);
+        texture->region.page = -1;
+        texture->region.texid = 0;
+        texture->region.u0 = 0.0f;
+        texture->region.v0 = 0.0f;
+        texture->region.u1 = 1.0f;
+        texture->region.v1 = 1.0f;
+    }
+    else
+    {
+        texture->atlased = atlas_add(image, width, height, &texture->region) != 0;
+    }
+
+    if (!texture->atlased && texture->pixels == nullptr)
+    {
+        GLuint texid = opengl_load(image, width, height);
+
+        if (texid == 0)
+        {
+            delete texture;
+            return nullptr;
+        }
+
+        texture->region.page = -1;
+        texture->region.texid = texid;
+        texture->region.u0 = 0.0f;
+        texture->region.v0 = 0.0f;
+        texture->region.u1 = 1.0f;
+        texture->region.v1 = 1.0f;
+    }
+
+    texture->framebuffer = 0;
+    texture->width = width;
+    texture->height = height;
+    texture->frame_duration = frame_duration;
+    texture->frame_count = frame_count;
+
+    return texture;
+}
+
+static void texture_free(texture_t* texture)
+{
+#ifdef DEBUG_TEXTURE
+	std::cout << "Unloaded " << texture->filename << std::endl;
+#endif
+
+	if (texture->pixels != nullptr)
+	{
+		free(texture->pixels);
+	}
+	else
+	{
+		// Pending quads may still reference this texture.
+		batch_flush();
+
+		if (texture->framebuffer != 0)
+		{
+			glstate_bind_framebuffer(0);
+			glDeleteFramebuffers(1, &texture->framebuffer);
+		}
+
+		if (texture->atlased)
+		{
+			atlas_remove(&texture->region);
+		}
+		else
+		{
+			glstate_delete_textures(1, &texture->region.texid);
+		}
+	}
+
+	delete texture;
+}
+
+texture_t* texture_target_create(int width, int height)
+{
+    if (opengl_software_enabled())
+    {
+        return nullptr;
+    }
+
+    GLuint texid = opengl_load(nullptr, width, height);
 
     if (texid == 0)
     {
-        std::cout << "Failed to load image from bytes." << std::endl;
         return nullptr;
     }
 
     auto texture = new texture_t;
 
-    texture->texid = texid;
+    texture->pixels = nullptr;
+
+    glGenFramebuffers(1, &texture->framebuffer);
+    glstate_bind_framebuffer(texture->framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texid, 0);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glstate_bind_framebuffer(0);
+
+    texture->atlased = false;
     texture->width = width;
     texture->height = height;
+    texture->frame_duration = 0.0f;
     texture->frame_count = 1;
+    cache_add(CACHE_TEXTURE, "", texture, (size_t)width * height * 4);
+
+    // The first row of a framebuffer is the bottom one, so the image
+    // has to be flipped vertically when it is drawn.
+    texture->region.page = -1;
+    texture->region.texid = texid;
+    texture->region.u0 = 0.0f;
+    texture->region.v0 = 1.0f;
+    texture->region.u1 = 1.0f;
+    texture->region.v1 = 0.0f;
 
 #ifdef DEBUG_TEXTURE
-	texture->filename = "From bytes";
+	texture->filename = "Render target";
 #endif
 
-	texture_count++;
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "Failed to create a " << width << "x" << height << " render target." << std::endl;
+        texture_close(texture);
+        return nullptr;
+    }
 
     return texture;
 }
 
-texture_t* texture_open(const std::string filename, int frame_count, float frame_duration)
+void texture_target_bind(texture_t* texture)
 {
-    unsigned width, height;
+    // Whatever was drawn so far belongs to the previous target.
+    batch_flush();
+    glstate_bind_framebuffer(texture != nullptr ? texture->framebuffer : 0);
+}
+
+texture_t* texture_from_bytes(unsigned char* bytes, int width, int height)
+{
+    auto texture = texture_create(bytes, width, height, 1, 0.0f);
+
+    if (texture == nullptr)
+    {
+        std::cout << "Failed to load image from bytes." << std::endl;
+        return nullptr;
+    }
+
+    cache_add(CACHE_TEXTURE, "", texture, (size_t)width * height * 4);
+
+#ifdef DEBUG_TEXTURE
+	texture->filename = "From bytes";
+#endif
+
+    return texture;
+}
+
+unsigned char* texture_decode(const std::string filename, int* width, int* height, arena_t* arena)
+{
+    TRACE_SCOPE_DETAIL("lodepng_decode32", filename.c_str());
+
     unsigned char* image;
-    unsigned error = lodepng_decode32_file(&image, &width, &height, filename.c_str());
+    unsigned w, h;
+
+    // Decoded straight from the mapping, without copying the file first.
+    file_map_t* map = file_map(filename);
+
+    if (map == nullptr)
+    {
+        std::cout << "File '" << filename << "' could not be opened." << std::endl;
+        return nullptr;
+    }
+
+    LodePNGState state;
 
-    if(error)
+    lodepng_state_init(&state);
+    state.info_raw.colortype = LCT_RGBA;
+    state.info_raw.bitdepth = 8;
+
+    // The header tells how much to reserve, so that the whole decoding
+    // allocates once.
+    arena_reserve_png(arena, file_map_data(map), file_map_size(map));
+    arena_use(arena);
+
+    unsigned error = lodepng_decode(&image, &w, &h, &state, file_map_data(map), file_map_size(map));
+    lodepng_state_cleanup(&state);
+    arena_use(nullptr);
+    file_unmap(map);
+
+    if (error)
     {
         std::cout << "File '" << filename << "' could not be loaded: " << lodepng_error_text(error) << std::endl;
         return nullptr;
     }
 
-	GLuint texid = opengl_load(image, width, height);
+    *width = (int)w;
+    *height = (int)h;
 
-    if (texid == 0)
+    return image;
+}
+
+texture_t* texture_share(const std::string filename, int frame_count)
+{
+    auto texture = (texture_t*)cache_find(CACHE_TEXTURE, filename);
+
+    if (texture != nullptr && texture->frame_count != frame_count)
+    {
+        std::cout << "'" << filename << "' is already open with " << texture->frame_count << " frames, not "
+                  << frame_count << "." << std::endl;
+    }
+
+    return texture;
+}
+
+texture_t* texture_from_image(const std::string filename, const unsigned char* image, int width, int height,
+                              int frame_count, float frame_duration)
+{
+    auto texture = texture_create(image, width, height, frame_count, frame_duration);
+
+    if (texture == nullptr)
     {
-        std::cout << "Failed to load image " << filename << " to OpenGL context." << std::endl;
         return nullptr;
     }
 
-	auto texture = new texture_t;
+    auto shared = (texture_t*)cache_add(CACHE_TEXTURE, filename, texture, (size_t)width * height * 4);
 
-    texture->texid = texid;
-    texture->width = width;
-    texture->height = height;
-	texture->frame_duration = frame_duration;
-	texture->frame_count = frame_count;
-	texture_count++;
+    // Opened by another thread meanwhile.
+    if (shared != texture)
+    {
+        texture_free(texture);
+    }
+
+    return shared;
+}
+
+// texture_from_image for decoded pixels, whose arena is deleted.
+static texture_t* texture_upload(const std::string filename, unsigned char* image, arena_t* arena,
+                                 int width, int height, int frame_count, float frame_duration)
+{
+	auto texture = texture_from_image(filename, image, width, height, frame_count, frame_duration);
+	arena_delete(arena);
+
+    if (texture == nullptr)
+    {
+        std::cout << "Failed to load image " << filename << " to OpenGL context." << std::endl;
+        return nullptr;
+    }
 
 #ifdef DEBUG_TEXTURE
 	texture->filename = filename;
-	std::cout << "Loaded " << filename << std::endl;
+	std::cout << "Loaded " << filename << (texture->atlased ? " into the atlas" : "") << std::endl;
 #endif
 
 	return texture;
 }
 
+texture_t* texture_open(const std::string filename, int frame_count, float frame_duration)
+{
+    TRACE_SCOPE_DETAIL("texture_open", filename.c_str());
+
+    auto shared = texture_share(filename, frame_count);
+
+    if (shared != nullptr)
+    {
+        return shared;
+    }
+
+    // Already decoded in the archive.
+    const pack_entry_t* entry = pack_find(filename);
+
+    if (entry != nullptr && entry->type == PACK_IMAGE)
+    {
+        if ((int)entry->frame_count != frame_count)
+        {
+            std::cout << "'" << filename << "' has " << entry->frame_count << " frames in the archive, not "
+                      << frame_count << "." << std::endl;
+        }
+
+        return texture_from_image(filename, pack_data(entry), entry->width, entry->height,
+                                  entry->frame_count, entry->frame_duration);
+    }
+
+    int width, height;
+    arena_t* arena = arena_create();
+    unsigned char* image = texture_decode(filename, &width, &height, arena);
+
+    if (image == nullptr)
+    {
+        arena_delete(arena);
+        return nullptr;
+    }
+
+    return texture_upload(filename, image, arena, width, height, frame_count, frame_duration);
+}
+
+// On a thread of the decode pool.
+static void texture_batch_job(void* data)
+{
+    auto file = (texture_batch_file_t*)data;
+    unsigned char* image = texture_decode(file->filename, &file->width, &file->height, file->arena);
+
+    {
+        std::lock_guard<std::mutex> lock(file->batch->mutex);
+        file->image = image;
+        file->done = true;
+    }
+
+    file->batch->decoded.notify_all();
+}
+
+int texture_open_batch(const texture_file_t* files, int count, texture_t** textures)
+{
+    TRACE_SCOPE("texture_open_batch");
+
+    texture_batch_t batch;
+    std::vector<texture_batch_file_t> decodes(count);
+    int opened = 0;
+
+    // Start decoding the files which aren't open already nor in the archive...
+    for (int i = 0; i < count; i++)
+    {
+        texture_batch_file_t* decode = &decodes[i];
+
+        decode->batch = &batch;
+        decode->filename = files[i].filename;
+        decode->arena = nullptr;
+        decode->image = nullptr;
+        decode->done = true;
+
+        textures[i] = texture_share(files[i].filename, files[i].frame_count);
+
+        if (textures[i] != nullptr || pack_find(files[i].filename) != nullptr || decode_pool == nullptr)
+        {
+            continue;
+        }
+
+        decode->arena = arena_create();
+        decode->done = false;
+        pool_submit(decode_pool, texture_batch_job, decode);
+    }
+
+    // ...and give them to OpenGL in order, as they are decoded.
+    for (int i = 0; i < count; i++)
+    {
+        texture_batch_file_t* decode = &decodes[i];
+
+        {
+            std::unique_lock<std::mutex> lock(batch.mutex);
+            batch.decoded.wait(lock, [decode] { return decode->done; });
+        }
+
+        if (textures[i] != nullptr)
+        {
+            // Already open.
+        }
+        else if (decode->arena == nullptr)
+        {
+            // In the archive, or no threads to decode it.
+            textures[i] = texture_open(files[i].filename, files[i].frame_count, files[i].frame_duration);
+        }
+        else if (decode->image != nullptr)
+        {
+            textures[i] = texture_upload(decode->filename, decode->image, decode->arena,
+                                         decode->width, decode->height, files[i].frame_count, files[i].frame_duration);
+        }
+        else
+        {
+            arena_delete(decode->arena);
+        }
+
+        if (textures[i] != nullptr)
+        {
+            opened++;
+        }
+    }
+
+    return opened == count ? 1 : 0;
+}
+
+texture_mesh_t* texture_mesh_create(texture_t* texture)
+{
+    auto mesh = new texture_mesh_t;
+    mesh->texture = texture;
+    return mesh;
+}
+
+void texture_mesh_add(texture_mesh_t* mesh, int x, int y, int frame)
+{
+    texture_t* texture = mesh->texture;
+    atlas_region_t* region = &texture->region;
+    GLfloat frame_width = (region->u1 - region->u0) / texture->frame_count;
+    batch_quad_t quad;
+
+    quad.x = (GLfloat)x;
+    quad.y = (GLfloat)y;
+    quad.width = (GLfloat)texture_frame_width(texture);
+    quad.height = (GLfloat)texture_frame_height(texture);
+
+    quad.u0 = region->u0 + frame_width * frame;
+    quad.v0 = region->v0;
+    quad.u1 = quad.u0 + frame_width;
+    quad.v1 = region->v1;
+
+    quad.r = 1.0f;
+    quad.g = 1.0f;
+    quad.b = 1.0f;
+    quad.a = 1.0f;
+
+    mesh->quads.push_back(quad);
+    mesh->frames.push_back(frame);
+}
+
+int texture_mesh_size(texture_mesh_t* mesh)
+{
+    return (int)mesh->quads.size();
+}
+
+void texture_mesh_render(texture_mesh_t* mesh, int count, GLfloat* projection, opengl_state_t* state)
+{
+    texture_t* texture = mesh->texture;
+
+    if (count > (int)mesh->quads.size())
+    {
+        count = (int)mesh->quads.size();
+    }
+
+    if (texture->pixels != nullptr)
+    {
+        int frame_width = texture_frame_width(texture);
+
+        for (int i = 0; i < count; i++)
+        {
+            const batch_quad_t* quad = &mesh->quads[i];
+
+            software_blit(
+                    texture->pixels, texture->width,
+                    mesh->frames[i] * frame_width, 0, frame_width, texture->height,
+                    state->px + (int)quad->x * state->scalex, state->py + (int)quad->y * state->scaley,
+                    state->scalex, state->scaley,
+                    state->r, state->g, state->b, state->a);
+        }
+
+        return;
+    }
+
+    batch_quads(texture->region.texid, projection, mesh->quads.data(), count, state);
+}
+
+void texture_mesh_close(texture_mesh_t* mesh)
+{
+    delete mesh;
+}
+
 void texture_close(texture_t* texture)
 {
-	if (texture != nullptr)
+	// Only freed once nothing uses it anymore.
+	if (texture != nullptr && cache_release(CACHE_TEXTURE, texture) == 0)
 	{
-#ifdef DEBUG_TEXTURE
-		std::cout << "Unloaded " << texture->filename << std::endl;
-#endif
-
-		glDeleteTextures(1, &texture->texid);
-		delete texture;
-		texture_count--;
+		texture_free(texture);
 	}
 }
 
@@ -362,11 +663,15 @@ float texture_frame_duration(texture_t* texture)
 
 void texture_finish()
 {
-	shader_close(&default_shader);
+	pool_delete(decode_pool);
+	decode_pool = nullptr;
 
-    if (texture_count != 0)
-    {
-        std::cout << "Asymetrical number of calls to texture_open and texture_close: " << texture_count << std::endl;
-    }
+	if (!opengl_software_enabled())
+	{
+		batch_finish();
+		atlas_finish();
+	}
+
+    cache_check(CACHE_TEXTURE);
 }
 
@@ -12,14 +12,18 @@
 #include <iostream>
 
 #include "../include/window.h"
+#include "../include/profile.h"
+#include "../include/trace.h"
 
 static SDL_Window*internal_window;
 static int internal_has_reset;
 static int internal_window_width, internal_window_height;
 static bool internal_is_fullscreen;
+static bool internal_opengl;
+static SDL_Surface* internal_frame; // wraps the pixels given to window_present
 static input_state_t input_state;
 
-int window_begin(const std::string program_name)
+int window_begin(const std::string program_name, bool opengl)
 {
     unsigned int flags;
     SDL_Renderer* renderer;
@@ -33,7 +37,15 @@ int window_begin(const std::string program_name)
         return 0;
     }
 
-    flags = SDL_WINDOW_RESIZABLE | SDL_WINDOW_OPENGL;
+    internal_opengl = opengl;
+    internal_frame = nullptr;
+
+    flags = SDL_WINDOW_RESIZABLE;
+
+    if (opengl)
+    {
+        flags |= SDL_WINDOW_OPENGL;
+    }
 
     SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
 
@@ -55,13 +67,20 @@ int window_begin(const std::string program_name)
         return 0;
     }
 
+    SDL_SetWindowMinimumSize(internal_window, REFERENCE_WIDTH, REFERENCE_HEIGHT);
+
+    if (!opengl)
+    {
+        // Frames are copied to the window surface by window_present.
+        return 1;
+    }
+
 	SDL_GLContext glContext = SDL_GL_CreateContext(internal_window);
 	SDL_GL_MakeCurrent(internal_window, glContext);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_ES);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 0);
 
-    SDL_SetWindowMinimumSize(internal_window, REFERENCE_WIDTH, REFERENCE_HEIGHT);
     SDL_GL_SetSwapInterval(1);
 
     renderer = SDL_CreateRenderer(
@@ -87,9 +106,72 @@ int window_was_reset(void)
 
 void window_finish()
 {
+    if (internal_frame != nullptr)
+    {
+        SDL_FreeSurface(internal_frame);
+        internal_frame = nullptr;
+    }
+
     SDL_Quit();
 }
 
+void window_present(const unsigned char* pixels, int width, int height)
+{
+    SDL_Surface* surface = SDL_GetWindowSurface(internal_window);
+
+    if (surface == nullptr)
+    {
+        return;
+    }
+
+    if (internal_frame == nullptr || internal_frame->pixels != pixels)
+    {
+        if (internal_frame != nullptr)
+        {
+            SDL_FreeSurface(internal_frame);
+        }
+
+        // The pixels are R, G, B, A bytes in memory.
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+        internal_frame = SDL_CreateRGBSurfaceFrom((void*)pixels, width, height, 32, width * 4,
+                                                  0xFF000000, 0x00FF0000, 0x0000FF00, 0x000000FF);
+#else
+        internal_frame = SDL_CreateRGBSurfaceFrom((void*)pixels, width, height, 32, width * 4,
+                                                  0x000000FF, 0x0000FF00, 0x00FF0000, 0xFF000000);
+#endif
+
+        if (internal_frame == nullptr)
+        {
+            return;
+        }
+
+        SDL_SetSurfaceBlendMode(internal_frame, SDL_BLENDMODE_NONE);
+    }
+
+    // Integer zoom, with the same border as the OpenGL renderer.
+    int zoom = internal_window_width / width;
+
+    if (internal_window_height / height < zoom)
+    {
+        zoom = internal_window_height / height;
+    }
+
+    if (zoom < 1)
+    {
+        zoom = 1;
+    }
+
+    SDL_Rect destination;
+    destination.w = width * zoom;
+    destination.h = height * zoom;
+    destination.x = (internal_window_width - destination.w) / 2;
+    destination.y = (internal_window_height - destination.h) / 2;
+
+    SDL_FillRect(surface, nullptr, SDL_MapRGB(surface->format, 13, 13, 26));
+    SDL_BlitScaled(internal_frame, nullptr, surface, &destination);
+    SDL_UpdateWindowSurface(internal_window);
+}
+
 int window_toggle_fullscreen()
 {
     // This will trigger a SDL_WINDOWEVENT_SIZE_CHANGED in any case.
@@ -167,6 +249,14 @@ static bool internal_window_events(void)
             else if (key == SDL_SCANCODE_F11)
             {
                 window_toggle_fullscreen();
+            }
+            else if (key == SDL_SCANCODE_F3)
+            {
+                PROFILE_HUD_TOGGLE();
+            }
+            else if (key == SDL_SCANCODE_F12)
+            {
+                trace_dump();
             }
 			else if (key == SDL_SCANCODE_LEFT)
 			{
@@ -218,7 +308,14 @@ static bool internal_window_events(void)
 
 bool window_step()
 {
-    SDL_GL_SwapWindow(internal_window);
+    if (internal_opengl)
+    {
+        PROFILE_SCOPE(PROFILE_PHASE_SWAP);
+        TRACE_SCOPE("SDL_GL_SwapWindow");
+        SDL_GL_SwapWindow(internal_window);
+    }
+
+    PROFILE_SCOPE(PROFILE_PHASE_EVENTS);
     return internal_window_events();
 }
 
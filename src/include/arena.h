@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <cstddef>
+
+// Bump allocator for the decoding of a file: the allocations are taken one
+// after the other from a single block, and all freed at once. A free only
+// gives the memory back when it is the last allocation left (as lodepng
+// does with its Huffman trees), and the last allocation grows in place. Once
+// the block is full, malloc is used.
+//
+// lodepng allocates in the arena used by the calling thread, or with malloc
+// if there is none.
+
+struct arena_t;
+
+arena_t* arena_create(void);
+
+// Frees everything which was allocated in it.
+void arena_delete(arena_t* arena);
+
+// Allocate the block, before anything else. Returns 0 if it failed, the
+// allocations then all go to malloc.
+int arena_reserve(arena_t* arena, size_t capacity);
+
+// arena_reserve with what decoding this PNG file allocates, from its
+// header. Returns 0 if the header couldn't be read.
+int arena_reserve_png(arena_t* arena, const unsigned char* png, size_t size);
+
+void* arena_alloc(arena_t* arena, size_t size);
+void* arena_realloc(arena_t* arena, void* ptr, size_t size);
+void arena_free(arena_t* arena, void* ptr);
+
+// Calls to malloc, realloc and free made so far, the block included.
+int arena_system_calls(arena_t* arena);
+
+// The arena lodepng allocates in on this thread, nullptr for malloc.
+void arena_use(arena_t* arena);
+
+#endif
@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+#ifndef _ATLAS_H_
+#define _ATLAS_H_
+
+#include <SDL_opengl.h>
+
+// A sub-rectangle of one of the atlas pages.
+struct atlas_region_t
+{
+    int page;
+    GLuint texid;
+    GLfloat u0, v0, u1, v1;
+    int x, y, width, height; // taken in the page, padding included
+};
+
+// Pack the image into one of the shared textures.
+// Returns 0 if there is no room left, in which case the caller
+// has to upload the image to its own texture.
+int atlas_add(const unsigned char* pixels, int width, int height, atlas_region_t* region);
+
+// The space of the region is given to the next images which fit in it,
+// and a page is released once all of its regions are removed.
+void atlas_remove(atlas_region_t* region);
+
+void atlas_finish(void);
+
+#endif
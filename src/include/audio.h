@@ -19,9 +19,33 @@ struct audio_t;
 extern int  audio_begin(void);
 extern void audio_finish(void);
 
+// Called instead of audio_begin to play nothing, without any device.
+// Sounds are still checked to be readable when loaded.
+extern int  audio_null_begin(void);
+
+// A file already loaded gives the same sound, which is freed once it
+// has been unloaded as many times.
 extern audio_t* audio_sound_load(const std::string filename);
 extern void audio_sound_unload(audio_t*);
 
+// audio_sound_load in two steps. The decoding to 16-bit samples can be
+// done on any thread, the samples are then given to OpenAL on the main one.
+struct audio_pcm_t
+{
+    int channels;
+    long samplerate;
+    char* buffer;
+    size_t size; // in bytes
+};
+
+extern int  audio_sound_decode(const std::string filename, audio_pcm_t* pcm);
+extern audio_t* audio_sound_from_pcm(const std::string filename, audio_pcm_t* pcm);
+
+// The sound of this file if it is already loaded (one more unload to
+// call), nullptr otherwise.
+extern audio_t* audio_sound_share(const std::string filename);
+extern void audio_pcm_free(audio_pcm_t* pcm);
+
 extern void audio_sound_play(audio_t*);
 extern void audio_sound_loop(audio_t*);
 extern void audio_sound_stop(audio_t*);
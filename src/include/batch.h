@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+#ifndef _BATCH_H_
+#define _BATCH_H_
+
+#include <SDL_opengl.h>
+
+#include "opengl.h"
+
+// One sprite. With instancing this is exactly what is sent to the GPU,
+// otherwise it is expanded to 4 vertices.
+struct batch_quad_t
+{
+    GLfloat x, y, width, height; // position and size in pixels
+    GLfloat u0, v0, u1, v1; // texture coordinates of the frame
+    GLfloat r, g, b, a; // color
+};
+
+struct batch_stats_t
+{
+    int draw_calls;
+    int quads;
+};
+
+// Instanced drawing is used when the driver supports it.
+int batch_begin(void);
+void batch_finish(void);
+
+// True if the quads are drawn as instances.
+bool batch_instanced(void);
+
+// Queue a quad. The pending quads are drawn when the texture or the
+// projection changes, when the buffer is full or when batch_flush is called.
+void batch_quad(GLuint texid, GLfloat* projection, const batch_quad_t* quad);
+
+// Queue quads given relative to the state's position, scaled by its
+// scale and tinted by its color.
+void batch_quads(GLuint texid, GLfloat* projection, const batch_quad_t* quads, int count, const opengl_state_t* state);
+
+// Draw everything that is pending. Must be called before any GL state
+// that affects drawing (scissor, framebuffer, ...) changes.
+void batch_flush(void);
+
+// Flush and start counting for a new frame.
+void batch_frame_end(void);
+
+// Statistics of the last completed frame.
+void batch_stats_get(batch_stats_t* stats);
+
+#endif
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+#ifndef _CACHE_H_
+#define _CACHE_H_
+
+#include <cstddef>
+#include <string>
+
+// Every texture and sound which is loaded, with how many times it is
+// used. Opening a file which is already loaded gives the same object
+// again, and it is only freed once everyone closed it.
+//
+// Objects without a file name (render targets, textures made from
+// bytes) are counted too, but never shared.
+
+enum cache_type_t
+{
+    CACHE_TEXTURE,
+    CACHE_SOUND,
+    CACHE_TYPE_COUNT
+};
+
+struct cache_stats_t
+{
+    int assets;
+    int references;
+    size_t bytes;
+    int loads; // opens which read the file
+    int hits;  // opens which found it loaded
+};
+
+// The object loaded from this file with one more reference, or nullptr.
+void* cache_find(cache_type_t type, const std::string filename);
+
+// Add a newly loaded object. If another thread added the same file in
+// the meantime, that one is returned with one more reference, and the
+// caller frees its own.
+void* cache_add(cache_type_t type, const std::string filename, void* object, size_t bytes);
+
+// Returns the references left. The object is freed by the caller at 0.
+int cache_release(cache_type_t type, void* object);
+
+void cache_stats_get(cache_type_t type, cache_stats_t* stats);
+
+// Print every object still loaded, returns how many there are.
+int cache_check(cache_type_t type);
+
+// Print the statistics of every object.
+void cache_report(void);
+
+#endif
@@ -1,13 +1,12 @@
 #ifndef __DIALOG_H__
 #define __DIALOG_H__
 
-#include <string>
-
 struct dialog_t;
 struct audio_t;
 struct font_t;
 
-dialog_t* dialog_init(std::string text, float r, float g, float b, float start_time);
+// The text is not copied: it has to outlive the dialog, like a string literal does.
+dialog_t* dialog_init(const char* text, float r, float g, float b, float start_time);
 void dialog_delete(dialog_t* dialog);
 
 void dialog_update(dialog_t* dialog, float dt);
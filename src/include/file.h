@@ -0,0 +1,30 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+#ifndef _FILE_H_
+#define _FILE_H_
+
+#include <cstddef>
+#include <string>
+
+// A file mapped in memory, read only. Nothing is copied: the pages are
+// read when they are first touched, and shared with every other process
+// mapping the same file.
+
+struct file_map_t;
+
+// nullptr if the file can't be opened.
+file_map_t* file_map(const std::string filename);
+void file_unmap(file_map_t* map);
+
+const unsigned char* file_map_data(file_map_t* map);
+size_t file_map_size(file_map_t* map);
+
+#endif
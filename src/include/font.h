@@ -18,10 +18,11 @@ struct font_t;
 font_t* font_open(const std::string filename);
 void font_close(font_t* font);
 
-void font_render(font_t* font, const std::string str);
-void font_render(font_t* font, const std::string str, int charcount);
+// The strings are not copied, nor kept after the call.
+void font_render(font_t* font, const char* str);
+void font_render(font_t* font, const char* str, int charcount);
 
-int font_width(font_t* font, const std::string str);
+int font_width(font_t* font, const char* str);
 int font_height(font_t* font);
 
 #endif
\ No newline at end of file
@@ -16,6 +16,9 @@ struct game_t
 	input_state_t input;
 	int current_level;
 	bool right_disabled;
+
+	// Where to draw the father, between the positions of the last two updates.
+	float father_x, father_y;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+#ifndef _GLSTATE_H_
+#define _GLSTATE_H_
+
+#include <SDL_opengl.h>
+
+// Shadow copy of the GL state we touch, so that calls which would not
+// change anything never reach the driver. Every bind of the state below
+// has to go through these functions, or the shadow copy will be wrong.
+
+struct glstate_stats_t
+{
+    int issued;  // calls that reached the driver
+    int skipped; // calls that were redundant
+    int texture_binds; // glBindTexture calls that reached the driver
+};
+
+// Forget everything we know, for example after the context was created.
+void glstate_reset(void);
+
+void glstate_use_program(GLuint program);
+void glstate_bind_texture(GLuint texture); // on GL_TEXTURE0, as a GL_TEXTURE_2D
+void glstate_bind_buffer(GLenum target, GLuint buffer);
+void glstate_bind_framebuffer(GLuint framebuffer); // 0 is the window
+void glstate_enable_attrib(GLuint index);
+
+void glstate_uniform1i(GLint location, GLint value);
+void glstate_uniform_matrix4fv(GLint location, const GLfloat* value);
+
+void glstate_scissor(bool enabled, int x, int y, int width, int height);
+bool glstate_scissor_is(bool enabled, int x, int y, int width, int height);
+
+void glstate_delete_textures(GLsizei count, const GLuint* textures);
+
+// Start counting for a new frame.
+void glstate_frame_end(void);
+
+// Counters of the last completed frame.
+void glstate_stats_get(glstate_stats_t* stats);
+
+#endif
@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+#ifndef _INPUT_SCRIPT_H_
+#define _INPUT_SCRIPT_H_
+
+#include <string>
+
+#include "window.h"
+
+// Keys to press, given per update instead of read from the window.
+// Each line of the file is an update number followed by the keys held
+// from that update on, until the next line:
+//
+//   # Walk right for two seconds, then up and right.
+//   0 right
+//   120 up right
+//   200
+
+int input_script_open(const std::string filename);
+void input_script_close(void);
+
+input_state_t input_script_get(int update);
+
+// The update of the last line.
+int input_script_length(void);
+
+#endif
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+#ifndef _INSTANCE_H_
+#define _INSTANCE_H_
+
+// One running game. Everything a game changes as it plays (the scenes,
+// the levels, the replay, ...) belongs to an instance, so that several
+// games can run at the same time, one per thread.
+//
+// Each module keeps its state in a struct of its own, made the first time
+// the module asks for it with instance_state, and deleted with the instance.
+// What is shared (textures, sounds, the renderer) stays out of it.
+
+enum instance_module_t
+{
+    INSTANCE_SESSION,
+    INSTANCE_INTRO,
+    INSTANCE_GAME,
+    INSTANCE_LEVEL1,
+    INSTANCE_LEVEL2,
+    INSTANCE_LEVEL3,
+    INSTANCE_LEVEL4,
+    INSTANCE_REPLAY,
+    INSTANCE_INPUT_SCRIPT,
+    INSTANCE_MODULE_COUNT
+};
+
+struct instance_t
+{
+    void* states[INSTANCE_MODULE_COUNT];
+    void(*destroy[INSTANCE_MODULE_COUNT])(void* state);
+};
+
+instance_t* instance_create(void);
+void instance_delete(instance_t* instance);
+
+// The instance the calling thread works on.
+extern thread_local instance_t* instance_current;
+
+template<typename T> void instance_destroy(void* state)
+{
+    delete (T*)state;
+}
+
+// The state of a module in the current instance. It starts value
+// initialized, like a static would be.
+template<typename T> T* instance_state(instance_module_t module)
+{
+    instance_t* instance = instance_current;
+
+    if (instance->states[module] == nullptr)
+    {
+        instance->states[module] = new T();
+        instance->destroy[module] = instance_destroy<T>;
+    }
+
+    return (T*)instance->states[module];
+}
+
+#endif
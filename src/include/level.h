@@ -5,17 +5,31 @@ struct opengl_state_t;
 struct font_t;
 struct game_t;
 
+#define LEVEL_NEIGHBOURS_MAX 4
+
 struct level_t
 {
 	int number;
 	float father_x, father_y;
 	bool initialized;
 
+	// The levels the player can go to from this one.
+	int neighbours[LEVEL_NEIGHBOURS_MAX];
+	int neighbour_count;
+
 	bool(*init)();
 	bool(*update)(float dt, game_t* game);
 	void(*render)(font_t* font, opengl_state_t* state, game_t* game);
 	void(*change)(level_t* old_level);
 	void(*finish)();
+
+	// The images and sounds of the level are only there while the
+	// player is near it. load starts loading them, loaded returns 1 once
+	// they are there, 0 while loading (never with wait) and -1 if they
+	// could not be loaded. unload frees them, loaded or not.
+	void(*load)();
+	int(*loaded)(bool wait);
+	void(*unload)();
 }; 
 
 #endif
\ No newline at end of file
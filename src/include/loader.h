@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+#ifndef _LOADER_H_
+#define _LOADER_H_
+
+#include <string>
+
+struct texture_t;
+struct audio_t;
+
+// Images and sounds decoded on a loader thread. The pixels and samples
+// are then given to OpenGL and OpenAL by loader_update, on the main thread.
+//
+// Without loader_begin (headless games, browsers without threads), files
+// are loaded right away and the loads are ready as soon as they are made.
+
+struct loader_t;
+
+int  loader_begin(void);
+
+// Waits for the files being decoded, and drops the loads nobody took
+// without uploading them. The ones not closed yet are then ready, with
+// nothing to take.
+void loader_finish(void);
+
+loader_t* loader_texture(const std::string filename, int frame_count, float frame_duration);
+loader_t* loader_sound(const std::string filename);
+
+// Upload what was decoded since the last call, once per frame. After
+// budget seconds, the rest waits for the next call (0: no limit).
+void loader_update(float budget);
+
+// 1 once uploaded (or failed), 0 while still loading.
+int  loader_ready(loader_t* load);
+
+// Wait until the load is ready.
+void loader_wait(loader_t* load);
+
+// Take what was loaded (nullptr if it failed) and free the load,
+// waiting for it if needed. loader_close frees it without taking it.
+texture_t* loader_texture_get(loader_t* load);
+audio_t*   loader_sound_get(loader_t* load);
+void loader_close(loader_t* load);
+
+#endif
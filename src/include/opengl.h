@@ -12,6 +12,7 @@
 #define _OPENGL_H_
 
 struct texture_t;
+struct texture_mesh_t;
 
 struct opengl_state_t
 {
@@ -23,6 +24,17 @@ struct opengl_state_t
 extern int opengl_begin(void);
 extern void opengl_finish(void);
 
+// Draw with the CPU into a framebuffer of the reference size instead of
+// using OpenGL. Called instead of opengl_begin, no GL context is needed.
+extern int opengl_software_begin(void);
+extern bool opengl_software_enabled(void);
+
+// Draw every frame at the reference size into an offscreen buffer,
+// and scale it to the window once in opengl_flush.
+// This is always the case with the software renderer.
+extern int opengl_offscreen_enable(void);
+extern bool opengl_offscreen_enabled(void);
+
 extern void opengl_save(opengl_state_t* state);
 extern void opengl_restore(opengl_state_t* state);
 
@@ -36,7 +48,13 @@ extern void opengl_scissor_disable(void);
 
 extern void opengl_clear(void);
 
+// Send everything drawn since the last call to the GPU. Call once per frame.
+extern void opengl_flush(void);
+
 extern void opengl_rectangle(int width, int height);
 extern void opengl_texture(texture_t* texture, int frame_current);
 
+// Draw the first 'count' frames of the mesh.
+extern void opengl_mesh(texture_mesh_t* mesh, int count);
+
 #endif
\ No newline at end of file
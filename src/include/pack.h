@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+#ifndef _PACK_H_
+#define _PACK_H_
+
+#include <cstdint>
+#include <string>
+
+// An archive of images and sounds which are already decoded, made by
+// tools/pack.cpp. When one is open, texture_open, audio_sound_load and
+// the loader take the files it has from it, and give the pixels and
+// samples to OpenGL and OpenAL as they are.
+//
+// The archive starts with a header, followed by the entries sorted by
+// name, and then the data of each entry, every one PACK_ALIGNMENT aligned.
+// Everything is little endian.
+
+#define PACK_MAGIC "a.man-pack-1"
+#define PACK_NAME_SIZE 48
+#define PACK_ALIGNMENT 16
+
+enum pack_type_t
+{
+    PACK_IMAGE = 1, // RGBA, 8 bits per channel
+    PACK_SOUND = 2  // 16-bit samples
+};
+
+struct pack_header_t
+{
+    char magic[16];
+    uint32_t entry_count;
+    uint32_t reserved[3];
+};
+
+struct pack_entry_t
+{
+    char name[PACK_NAME_SIZE]; // as opened by the game, eg. "data/father.png"
+    uint32_t type;
+    uint32_t offset; // from the start of the archive
+    uint32_t size; // in bytes
+
+    // Images only
+    uint32_t width, height;
+    uint32_t frame_count;
+    float frame_duration;
+
+    // Sounds only
+    uint32_t channels;
+    uint32_t samplerate;
+
+    uint32_t reserved[3];
+};
+
+// Map the archive in memory. Returns 0 if it can't be used.
+int pack_open(const std::string filename);
+void pack_close(void);
+
+// nullptr if there is no archive, or it doesn't have the file.
+const pack_entry_t* pack_find(const std::string name);
+const unsigned char* pack_data(const pack_entry_t* entry);
+
+#endif
@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+#ifndef _POOL_H_
+#define _POOL_H_
+
+// Worker threads running jobs in the order they were submitted.
+
+struct pool_t;
+
+// With 0 threads, there is one per core.
+pool_t* pool_create(int thread_count);
+
+// Waits for the jobs that were submitted.
+void pool_delete(pool_t* pool);
+
+void pool_submit(pool_t* pool, void(*job)(void* data), void* data);
+
+// Wait until every submitted job is done.
+void pool_wait(pool_t* pool);
+
+int pool_thread_count(pool_t* pool);
+
+#endif
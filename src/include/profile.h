@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+// Frame profiler. Only built when PROFILE is defined (debug builds),
+// otherwise the macros below expand to nothing.
+//
+// PROFILE_FRAME() is called once at the start of every frame and measures
+// the time between frames. PROFILE_SCOPE(phase) measures the time until
+// the end of the enclosing block. The last PROFILE_SAMPLES values of each
+// phase are kept for the statistics.
+
+enum profile_phase_t
+{
+    PROFILE_PHASE_FRAME,
+    PROFILE_PHASE_SWAP,
+    PROFILE_PHASE_EVENTS,
+    PROFILE_PHASE_UPDATE,
+    PROFILE_PHASE_RENDER,
+    PROFILE_PHASE_FLUSH,
+    PROFILE_PHASE_COUNT
+};
+
+#ifdef PROFILE
+
+#include <chrono>
+
+struct font_t;
+struct opengl_state_t;
+
+struct profile_scope_t
+{
+    profile_scope_t(profile_phase_t phase);
+    ~profile_scope_t();
+
+    profile_phase_t phase;
+    std::chrono::steady_clock::time_point start;
+};
+
+// Statistics of a phase in milliseconds.
+struct profile_stats_t
+{
+    float min, mean, p99, max;
+};
+
+void profile_frame(void);
+void profile_stats_get(profile_phase_t phase, profile_stats_t* stats);
+
+// The overlay is hidden until toggled (F3).
+void profile_hud_toggle(void);
+void profile_hud_render(font_t* font, opengl_state_t* state);
+
+// Print the statistics of every phase.
+void profile_report(void);
+
+#define PROFILE_FRAME() profile_frame()
+#define PROFILE_SCOPE(phase) profile_scope_t profile_scope(phase)
+#define PROFILE_HUD_TOGGLE() profile_hud_toggle()
+#define PROFILE_HUD_RENDER(font, state) profile_hud_render(font, state)
+#define PROFILE_REPORT() profile_report()
+
+#else
+
+#define PROFILE_FRAME()
+#define PROFILE_SCOPE(phase)
+#define PROFILE_HUD_TOGGLE()
+#define PROFILE_HUD_RENDER(font, state)
+#define PROFILE_REPORT()
+
+#endif
+
+#endif
@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+#ifndef _REPLAY_H_
+#define _REPLAY_H_
+
+#include <string>
+
+#include "window.h"
+
+// Record the keys of every update and the random seeds to a file, or play
+// them back. Since the updates have a fixed dt, a replay does exactly what
+// the recorded game did.
+//
+// The file only has the changes of the keys, with the number of updates
+// since the previous change, so a game of an hour takes a few kilobytes.
+
+int replay_record_open(const std::string filename);
+int replay_play_open(const std::string filename);
+
+// Write the end of the recording.
+void replay_close(void);
+
+bool replay_playing(void);
+
+// The number of updates recorded.
+int replay_length(void);
+
+// The seed for a random engine. It is recorded, or read back.
+unsigned int replay_seed(void);
+
+// The keys for the given update: they are recorded, or replaced by the
+// recorded ones. Updates are given in order.
+input_state_t replay_input(int update, input_state_t input);
+
+#endif
@@ -9,9 +9,19 @@ struct opengl_state_t;
 struct scene_t
 {
 	bool(*init)();
+	// 1 once the assets init started loading are there, 0 while loading,
+	// -1 if they could not be loaded. Nothing is updated or drawn before.
+	// nullptr if init loads everything itself.
+	int(*ready)();
 	bool(*update)(float dt, input_state_t input);
-	void(*render)(font_t* font, opengl_state_t* state);
+	// alpha, from 0 to 1, is how far we are between the last update and
+	// the next one, to draw moving things in between their two positions.
+	void(*render)(font_t* font, opengl_state_t* state, float alpha);
 	void(*finish)();
+
+	// Fills in the scene coming after this one, which is started (and
+	// loads) while this one plays. nullptr to start this one again.
+	void(*successor)(scene_t* scene);
 };
 
 extern void intro_scene_get(scene_t* scene);
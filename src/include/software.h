@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+#ifndef _SOFTWARE_H_
+#define _SOFTWARE_H_
+
+#include <string>
+
+// CPU rasterizer drawing into an RGBA8 framebuffer, used instead of
+// OpenGL when there is no GPU. Colors are modulated and alpha blended
+// the same way as the OpenGL path does.
+
+int software_begin(int width, int height);
+void software_finish(void);
+
+// Append every frame as raw RGBA8 to the file.
+int software_capture_open(const std::string filename);
+
+void software_clear(unsigned char r, unsigned char g, unsigned char b);
+
+// Same coordinates as glScissor: the origin is the bottom-left corner.
+void software_scissor_enable(int x, int y, int width, int height);
+void software_scissor_disable(void);
+
+// Draw the sw x sh rectangle at (sx, sy) of an image 'pitch' pixels wide,
+// with its top-left corner at (dx, dy) and each pixel repeated scalex x scaley times.
+void software_blit(
+        const unsigned char* pixels, int pitch,
+        int sx, int sy, int sw, int sh,
+        int dx, int dy, int scalex, int scaley,
+        float r, float g, float b, float a);
+
+// Called once the frame is complete.
+void software_frame_end(void);
+
+const unsigned char* software_pixels(void);
+int software_width(void);
+int software_height(void);
+
+#endif
@@ -17,16 +17,55 @@
 #include "opengl.h"
 
 struct texture_t;
+struct texture_mesh_t;
+struct arena_t;
 
 int texture_begin(void);
 void texture_finish(void);
 
-// From file
+// From file. A file already open gives the same texture, which is freed
+// once it has been closed as many times.
 texture_t* texture_open(const std::string filename, int frame_count, float frame_duration);
 texture_t* texture_from_bytes(unsigned char* bytes, int width, int height);
 
+struct texture_file_t
+{
+    const char* filename;
+    int frame_count;
+    float frame_duration;
+};
+
+// texture_open for each file, decoded on all the cores at once and given to
+// OpenGL in order on this thread. A texture which failed is nullptr, and 0
+// is returned if there was any.
+int texture_open_batch(const texture_file_t* files, int count, texture_t** textures);
+
+// texture_open in two steps. The decoding doesn't touch OpenGL and can be
+// done on any thread, the pixels are then given to texture_from_image on the
+// thread of the OpenGL context. They are in the arena (a new one, see
+// arena.h), to delete once they have been given.
+unsigned char* texture_decode(const std::string filename, int* width, int* height, arena_t* arena);
+texture_t* texture_from_image(const std::string filename, const unsigned char* image, int width, int height,
+                              int frame_count, float frame_duration);
+
+// The texture of this file if it is already open (one more texture_close
+// to call), nullptr otherwise.
+texture_t* texture_share(const std::string filename, int frame_count);
+
+// A texture that can be drawn into. Binding nullptr draws to the window again.
+texture_t* texture_target_create(int width, int height);
+void texture_target_bind(texture_t* texture);
+
 void texture_render(texture_t* texture, int frame_current, GLfloat* projection, opengl_state_t* state);
 
+// A prebuilt list of frames of one texture, drawn in one go.
+// Offsets are in pixels, relative to the current position.
+texture_mesh_t* texture_mesh_create(texture_t* texture);
+void texture_mesh_add(texture_mesh_t* mesh, int x, int y, int frame);
+int texture_mesh_size(texture_mesh_t* mesh);
+void texture_mesh_render(texture_mesh_t* mesh, int count, GLfloat* projection, opengl_state_t* state);
+void texture_mesh_close(texture_mesh_t* mesh);
+
 // Returns the frame width, ie. width / frame_count
 int texture_frame_width(texture_t* texture);
 int texture_frame_height(texture_t* texture);
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <string>
+
+// Timeline of begin/end events, written as Chrome trace JSON
+// (chrome://tracing, ui.perfetto.dev). The last TRACE_CAPACITY events are
+// kept in a ring buffer, which any thread can add to.
+//
+// Nothing is recorded until trace_begin is called. The names must be
+// string literals, the details are copied (and cut if too long).
+
+int trace_begin(const std::string filename);
+
+// Write the file, and stop recording.
+void trace_finish(void);
+
+// Write the file with the events recorded so far.
+void trace_dump(void);
+
+void trace_event_begin(const char* name, const char* detail);
+void trace_event_end(const char* name);
+
+struct trace_scope_t
+{
+    trace_scope_t(const char* name, const char* detail) : name(name)
+    {
+        trace_event_begin(name, detail);
+    }
+
+    ~trace_scope_t()
+    {
+        trace_event_end(name);
+    }
+
+    const char* name;
+};
+
+#define TRACE_SCOPE(name) trace_scope_t trace_scope(name, nullptr)
+#define TRACE_SCOPE_DETAIL(name, detail) trace_scope_t trace_scope(name, detail)
+
+#endif
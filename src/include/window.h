@@ -23,10 +23,14 @@ struct input_state_t
 
 extern int window_was_reset(void);
 
-extern int  window_begin(const std::string program_name);
+// Without OpenGL, frames are shown with window_present.
+extern int  window_begin(const std::string program_name, bool opengl);
 extern void window_finish(void);
 
 extern bool window_step(void);
+
+// Show an RGBA8 frame of the reference size, scaled to the window.
+extern void window_present(const unsigned char* pixels, int width, int height);
 extern int window_toggle_fullscreen(void);
 
 extern int window_width_get(void);
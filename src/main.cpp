@@ -4,8 +4,21 @@
 #include "include/font.h"
 #include "include/audio.h"
 #include "include/scene.h"
-
+#include "include/software.h"
+#include "include/profile.h"
+#include "include/trace.h"
+#include "include/input_script.h"
+#include "include/replay.h"
+#include "include/instance.h"
+#include "include/pool.h"
+#include "include/loader.h"
+#include "include/pack.h"
+
+#include <atomic>
 #include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
 #include <thread>
 
 #include <SDL.h> // If SDLmain is needed
@@ -15,14 +28,66 @@
 #include <emscripten.h>
 #endif
 
+// The game is updated FPS times per second, whatever the display rate is.
 #define FPS 60
 
+// After a long frame, at most this many updates are made to catch up.
+// The rest of the time is dropped: the game slows down instead of freezing.
+#define UPDATES_MAX 5
+
+// Without vertical sync, don't draw more often than this.
+#define FRAME_RATE_MAX 240
+
+// While a scene plays, the images and sounds loaded for the next one
+// are given to OpenGL and OpenAL for at most this long each frame (seconds).
+#define UPLOAD_BUDGET 0.002f
+
 //static texture_t* cursor;
 static font_t* font;
 
-static scene_t current_scene;
 static bool window_continue = true;
 
+// The game being played, in the current instance.
+struct session_t
+{
+	scene_t scene;
+
+	// The scene coming after this one, started early so that it loads meanwhile.
+	scene_t next;
+	bool next_started;
+
+	// The scene just left, finished once the new one has been drawn.
+	scene_t previous;
+	bool previous_pending;
+
+	int index; // of the headless games running at once
+
+	// Time not yet simulated, in seconds.
+	double time_pending;
+	std::chrono::steady_clock::time_point time_last;
+	int update_count;
+};
+
+static session_t* session_current()
+{
+	return instance_state<session_t>(INSTANCE_SESSION);
+}
+
+// Command line options
+static bool option_offscreen = false;
+static bool option_software = false;
+static std::string option_capture;
+static std::string option_trace;
+static bool option_headless = false;
+static int option_frames = 0;
+static std::string option_input;
+static std::string option_record;
+static std::string option_replay;
+static int option_sessions = 1;
+static int option_threads = 0;
+static bool option_fuzz = false;
+static std::string option_pack = "data.pack"; // made by a.man-pack, used if it's there
+
 static void prepare_drawing(
 	opengl_state_t* initial_state, opengl_state_t* zoomed_state, int& zoom, input_state_t& input_state)
 {
@@ -54,6 +119,15 @@ static void prepare_drawing(
 	input_state = window_input_state_get();
 
 	opengl_clear();
+
+	if (opengl_offscreen_enabled())
+	{
+		// We draw at the reference size, opengl_flush does the scaling and the border.
+		zoom = 1;
+		opengl_save(zoomed_state);
+		return;
+	}
+
     opengl_scissor_disable(); // Make sure we can draw everywhere
 
     // Left and right border
@@ -84,36 +158,135 @@ static void prepare_drawing(
     opengl_scissor_enable(borderx, bordery, REFERENCE_WIDTH * zoom, REFERENCE_HEIGHT * zoom);
 }
 
+static int scene_ready(scene_t* scene)
+{
+	return scene->ready != nullptr ? scene->ready() : 1;
+}
+
 static bool scene_step(scene_t* scene)
 {
+	TRACE_SCOPE("scene_step");
+
+	session_t* session = session_current();
+
 	int zoom;
 	input_state_t input_state;
 	opengl_state_t zoomed_state, initial_state;
 
 	prepare_drawing(&initial_state, &zoomed_state, zoom, input_state);
 
-	float dt = 1.0f / FPS;
+	// Nothing moves until the scene is loaded, and the loading time isn't game time.
+	int ready = scene_ready(scene);
 
-	if (!scene->update(dt, input_state))
-		return false;
+	loader_update(ready == 1 ? UPLOAD_BUDGET : 0.0f);
 
-	scene->render(font, &zoomed_state);
+	if (session->next_started)
+	{
+		scene_ready(&session->next);
+	}
 
-	return true;
+	if (ready != 1)
+	{
+		session->time_last = std::chrono::steady_clock::now();
+		session->time_pending = 0.0;
+
+		opengl_flush();
+		return true;
+	}
+
+	const double dt = 1.0 / FPS;
+	auto now = std::chrono::steady_clock::now();
+	bool do_continue = true;
+
+	// A capture is made offline, it always advances by exactly one update.
+	if (option_capture.empty())
+	{
+		session->time_pending += std::chrono::duration<double>(now - session->time_last).count();
+	}
+	else
+	{
+		session->time_pending += dt;
+	}
+
+	session->time_last = now;
+
+	{
+		PROFILE_SCOPE(PROFILE_PHASE_UPDATE);
+
+		for (int i = 0; i < UPDATES_MAX && session->time_pending >= dt && do_continue; i++)
+		{
+			// With an input script, the keyboard is ignored.
+			if (!option_input.empty())
+			{
+				input_state = input_script_get(session->update_count);
+			}
+
+			input_state = replay_input(session->update_count, input_state);
+
+			do_continue = scene->update((float)dt, input_state);
+			session->update_count++;
+			session->time_pending -= dt;
+		}
+
+		if (session->time_pending >= dt)
+		{
+			session->time_pending = 0.0;
+		}
+	}
+
+	if (do_continue)
+	{
+		PROFILE_SCOPE(PROFILE_PHASE_RENDER);
+		scene->render(font, &zoomed_state, (float)(session->time_pending / dt));
+		PROFILE_HUD_RENDER(font, &zoomed_state);
+	}
+
+	{
+		PROFILE_SCOPE(PROFILE_PHASE_FLUSH);
+		opengl_flush();
+	}
+
+	return do_continue;
 }
 
-static bool init()
+// The renderer, the audio and what every game shares.
+static bool engine_begin()
 {
-    if (!window_begin("a.man"))
-    {
-        return false;
-    }
+	// Without a window, nothing is drawn, but the software renderer
+	// keeps the images in memory for the sizes the game needs.
+	if (option_headless)
+	{
+		if (!opengl_software_begin())
+		{
+			return false;
+		}
+	}
+	else
+	{
+		if (!window_begin("a.man", !option_software))
+		{
+			return false;
+		}
+
+		if (!(option_software ? opengl_software_begin() : opengl_begin()))
+		{
+			window_finish();
+			return false;
+		}
+	}
 
-	if (!opengl_begin())
-    {
+	if (!option_capture.empty() && !software_capture_open(option_capture))
+	{
+		opengl_finish();
 		window_finish();
-        return false;
-    }
+		return false;
+	}
+
+	// Without it, every file is decoded when it's opened.
+	if (!option_pack.empty())
+	{
+		pack_open(option_pack);
+	}
 
 	if (!texture_begin())
 	{
@@ -122,7 +295,12 @@ static bool init()
 		return false;
 	}
 
-	if (!audio_begin())
+	if (option_offscreen && !option_software && !opengl_offscreen_enable())
+	{
+		std::cout << "Offscreen rendering is not available, drawing to the window directly." << std::endl;
+	}
+
+	if (!(option_headless ? audio_null_begin() : audio_begin()))
     {
 		texture_finish();
 		opengl_finish();
@@ -131,13 +309,22 @@ static bool init()
     }
 
 	font = font_open("data/font.png");
-	intro_scene_get(&current_scene);
 
-	if (font == nullptr
-		|| !current_scene.init())
+	if (font == nullptr)
 	{
-		font_close(font);
+		audio_finish();
+		texture_finish();
+		opengl_finish();
+		window_finish();
 
+		return false;
+	}
+
+	// The headless games already have a thread each, they load their files
+	// themselves. A capture must not depend on how long the loading takes.
+	if (!option_headless && option_capture.empty() && !loader_begin())
+	{
+		font_close(font);
 		audio_finish();
 		texture_finish();
 		opengl_finish();
@@ -149,20 +336,193 @@ static bool init()
 	return true;
 }
 
-static void finish()
+static void engine_finish()
 {
-	current_scene.finish();
-
+	loader_finish();
 	font_close(font);
 
     audio_finish();
 	opengl_finish();
 	texture_finish();
     window_finish();
+
+	pack_close();
+	trace_finish();
+}
+
+// Several headless games each record to, replay and script from their own
+// file, so that a recording of --sessions 4 is replayed with --sessions 4.
+static std::string session_filename(const std::string filename, int index)
+{
+	if (option_sessions > 1)
+	{
+		return filename + "." + std::to_string(index);
+	}
+
+	return filename;
+}
+
+// Start the scene coming after the current one, if there is one.
+static void scene_prefetch()
+{
+	session_t* session = session_current();
+
+	if (session->scene.successor == nullptr)
+	{
+		return;
+	}
+
+	TRACE_SCOPE("scene_prefetch");
+
+	session->scene.successor(&session->next);
+	session->next_started = session->next.init();
+}
+
+// Finish the previous scene once the current one has been drawn,
+// or right away with force.
+static void scene_release(bool force)
+{
+	session_t* session = session_current();
+
+	if (!session->previous_pending || (!force && scene_ready(&session->scene) != 1))
+	{
+		return;
+	}
+
+	TRACE_SCOPE("scene_finish");
+
+	session->previous.finish();
+	session->previous_pending = false;
+}
+
+// Start a game in the current instance.
+static bool session_begin(int index)
+{
+	session_t* session = session_current();
+
+	session->index = index;
+
+	if (!option_input.empty() && !input_script_open(session_filename(option_input, index)))
+	{
+		return false;
+	}
+
+	// Opened before the first scene, which asks for a seed.
+	if ((!option_record.empty() && !replay_record_open(session_filename(option_record, index)))
+		|| (!option_replay.empty() && !replay_play_open(session_filename(option_replay, index))))
+	{
+		replay_close();
+		return false;
+	}
+
+	session->next_started = false;
+	session->previous_pending = false;
+
+	intro_scene_get(&session->scene);
+
+	if (!session->scene.init())
+	{
+		replay_close();
+		return false;
+	}
+
+	scene_prefetch();
+
+	session->time_last = std::chrono::steady_clock::now();
+	session->time_pending = 0.0;
+	session->update_count = 0;
+
+	return true;
+}
+
+static void session_finish()
+{
+	session_t* session = session_current();
+
+	scene_release(true);
+	session->scene.finish();
+
+	if (session->next_started)
+	{
+		session->next.finish();
+		session->next_started = false;
+	}
+
+	replay_close();
+	input_script_close();
+}
+
+static bool init()
+{
+	if (!engine_begin())
+	{
+		return false;
+	}
+
+	instance_current = instance_create();
+
+	if (!session_begin(0))
+	{
+		instance_delete(instance_current);
+		engine_finish();
+		return false;
+	}
+
+	return true;
+}
+
+static void finish()
+{
+	PROFILE_REPORT();
+
+	session_finish();
+	instance_delete(instance_current);
+
+	engine_finish();
+}
+
+static void scene_next()
+{
+	session_t* session = session_current();
+
+	TRACE_SCOPE("scene_change");
+
+	if (!session->next_started)
+	{
+		// The same scene again, or one that couldn't start early.
+		{
+			TRACE_SCOPE("scene_finish");
+			session->scene.finish();
+		}
+
+		if (session->scene.successor != nullptr)
+		{
+			session->scene.successor(&session->scene);
+		}
+
+		{
+			TRACE_SCOPE("scene_init");
+			session->scene.init();
+		}
+	}
+	else
+	{
+		// The next scene has been loading all along, so this is only a swap.
+		scene_release(true);
+
+		session->previous = session->scene;
+		session->previous_pending = true;
+		session->scene = session->next;
+		session->next_started = false;
+	}
+
+	scene_prefetch();
 }
 
 static void step()
 {
+    PROFILE_FRAME();
+
     if (!window_step())
     {
         finish();
@@ -174,34 +534,255 @@ static void step()
         return;
     }
 
-	if (!scene_step(&current_scene))
+	session_t* session = session_current();
+
+	if (!scene_step(&session->scene))
+	{
+		scene_next();
+
+		// The loading time isn't game time.
+		session->time_last = std::chrono::steady_clock::now();
+		session->time_pending = 0.0;
+	}
+	else
+	{
+		scene_release(false);
+	}
+
+	if (scene_ready(&session->scene) < 0)
 	{
-		current_scene.finish();
-		//editor_scene_get(&current_scene);
-		game_scene_get(&current_scene);
-		current_scene.init();
+		std::cout << "The scene could not be loaded." << std::endl;
+		finish();
+
+#ifdef __EMSCRIPTEN__
+		emscripten_cancel_main_loop();
+#endif
+		window_continue = false;
 	}
 }
 
+static void parse_options(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+
+		if (option == "--offscreen")
+		{
+			option_offscreen = true;
+		}
+		else if (option == "--software")
+		{
+			option_software = true;
+		}
+		else if (option == "--capture" && i + 1 < argc)
+		{
+			// The capture is made from the software framebuffer.
+			option_software = true;
+			option_capture = argv[++i];
+		}
+		else if (option == "--trace" && i + 1 < argc)
+		{
+			option_trace = argv[++i];
+		}
+		else if (option == "--headless")
+		{
+			option_headless = true;
+		}
+		else if (option == "--frames" && i + 1 < argc)
+		{
+			option_frames = atoi(argv[++i]);
+		}
+		else if (option == "--input" && i + 1 < argc)
+		{
+			option_input = argv[++i];
+		}
+		else if (option == "--record" && i + 1 < argc)
+		{
+			option_record = argv[++i];
+		}
+		else if (option == "--replay" && i + 1 < argc)
+		{
+			option_replay = argv[++i];
+		}
+		else if (option == "--sessions" && i + 1 < argc)
+		{
+			option_sessions = atoi(argv[++i]);
+		}
+		else if (option == "--threads" && i + 1 < argc)
+		{
+			option_threads = atoi(argv[++i]);
+		}
+		else if (option == "--fuzz")
+		{
+			option_fuzz = true;
+		}
+		else if (option == "--pack" && i + 1 < argc)
+		{
+			// An empty name reads the files in data/ instead.
+			option_pack = argv[++i];
+		}
+		else
+		{
+			std::cout << "Unknown option: " << option << std::endl;
+		}
+	}
+}
+
+static std::atomic<int> headless_failures;
+
+// Random keys, changed every half second on average.
+static input_state_t fuzz_input(std::minstd_rand& random_engine, input_state_t input)
+{
+	if (random_engine() % (FPS / 2) == 0)
+	{
+		unsigned int keys = random_engine();
+
+		input.up = (keys & 1) != 0;
+		input.down = (keys & 2) != 0;
+		input.left = (keys & 4) != 0;
+		input.right = (keys & 8) != 0;
+	}
+
+	return input;
+}
+
+// Run the updates of one game as fast as possible, without drawing
+// anything. It has an instance of its own, so it can run on any thread.
+static void headless_session(void* data)
+{
+	int index = (int)(intptr_t)data;
+	instance_t* instance = instance_create();
+
+	instance_current = instance;
+
+	if (!session_begin(index))
+	{
+		std::cout << "Game " << index << " could not start." << std::endl;
+		headless_failures++;
+		instance_delete(instance);
+		return;
+	}
+
+	session_t* session = session_current();
+	const float dt = 1.0f / FPS;
+	int frames = option_frames;
+
+	// By default, a replay is played to its end, otherwise an hour of game.
+	if (frames <= 0)
+	{
+		frames = replay_playing() ? replay_length() : 60 * 60 * FPS;
+	}
+
+	std::minstd_rand fuzz_engine(index + 1);
+	input_state_t input_state = input_state_t();
+
+	for (; session->update_count < frames; session->update_count++)
+	{
+		// Without the loader thread, the scenes are ready as soon as they start.
+		if (scene_ready(&session->scene) < 0)
+		{
+			std::cout << "Game " << index << " could not load its scene." << std::endl;
+			headless_failures++;
+			break;
+		}
+
+		if (option_fuzz)
+		{
+			input_state = fuzz_input(fuzz_engine, input_state);
+		}
+		else
+		{
+			input_state = input_script_get(session->update_count);
+		}
+
+		input_state = replay_input(session->update_count, input_state);
+
+		if (!session->scene.update(dt, input_state))
+		{
+			scene_next();
+		}
+		else
+		{
+			scene_release(false);
+		}
+	}
+
+	session_finish();
+	instance_delete(instance);
+}
+
+// Run the headless games on a thread pool, and report how long it took.
+static int headless_run()
+{
+	auto start = std::chrono::steady_clock::now();
+	pool_t* pool = pool_create(option_sessions > 1 ? option_threads : 1);
+
+	headless_failures = 0;
+
+	for (int i = 0; i < option_sessions; i++)
+	{
+		pool_submit(pool, headless_session, (void*)(intptr_t)i);
+	}
+
+	pool_wait(pool);
+
+	std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+
+	std::cout << option_sessions << " game(s) on " << pool_thread_count(pool) << " thread(s) in "
+	          << duration.count() << " ms" << std::endl;
+
+	pool_delete(pool);
+
+	return headless_failures == 0;
+}
+
 int main(int argc, char* argv[])
 {
+	parse_options(argc, argv);
+
+	// Started first, so that the loading is on the timeline too.
+	if (!option_trace.empty())
+	{
+		trace_begin(option_trace);
+	}
+
+	if (option_headless)
+	{
+		if (!engine_begin())
+		{
+			return 1;
+		}
+
+		int success = headless_run();
+		engine_finish();
+
+		return success ? 0 : 1;
+	}
+
 	if (!init())
 	{
 		return 1;
 	}
 
 #ifdef __EMSCRIPTEN__
-    emscripten_set_main_loop(step, FPS, 1);
+    // Draw at the rate of the browser, scene_step measures the time itself.
+    emscripten_set_main_loop(step, 0, 1);
 #else
-    typedef std::chrono::duration<int, std::ratio<1, FPS>> frame_duration;
+    typedef std::chrono::duration<int, std::ratio<1, FRAME_RATE_MAX>> frame_duration;
 
     while(window_continue)
     {
-        auto endtime = std::chrono::system_clock::now() + frame_duration(1);
+        auto endtime = std::chrono::steady_clock::now() + frame_duration(1);
         step();
-        std::this_thread::sleep_until(endtime);
+
+        // A capture is made offline, as fast as possible.
+        if (option_capture.empty())
+        {
+            std::this_thread::sleep_until(endtime);
+        }
     }
 #endif
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+#include "../include/arena.h"
+#include "lodepng/lodepng.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Before each allocation in the block, aligned like malloc.
+struct arena_header_t
+{
+    size_t size;
+    size_t previous; // offset of the header of the allocation before, NONE if first
+    bool freed;
+};
+
+#define ARENA_ALIGNMENT 16
+#define ARENA_HEADER_SIZE ((sizeof(arena_header_t) + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT)
+#define ARENA_NONE ((size_t)-1)
+
+struct arena_t
+{
+    unsigned char* block;
+    size_t capacity;
+    size_t top;
+    size_t last; // offset of the header of the last allocation, ARENA_NONE if empty
+
+    std::vector<void*> overflow; // with malloc, once the block was full
+    int system_calls;
+};
+
+static thread_local arena_t* arena_current = nullptr;
+
+static size_t arena_round(size_t size)
+{
+    return (size + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+}
+
+static arena_header_t* arena_header(arena_t* arena, size_t offset)
+{
+    return (arena_header_t*)(arena->block + offset);
+}
+
+static bool arena_owns(arena_t* arena, const void* ptr)
+{
+    auto bytes = (const unsigned char*)ptr;
+    return arena->block != nullptr && bytes >= arena->block && bytes < arena->block + arena->capacity;
+}
+
+arena_t* arena_create()
+{
+    auto arena = new arena_t;
+
+    arena->block = nullptr;
+    arena->capacity = 0;
+    arena->top = 0;
+    arena->last = ARENA_NONE;
+    arena->system_calls = 0;
+
+    return arena;
+}
+
+void arena_delete(arena_t* arena)
+{
+    if (arena == nullptr)
+    {
+        return;
+    }
+
+    for (void* ptr : arena->overflow)
+    {
+        free(ptr);
+    }
+
+    free(arena->block);
+    delete arena;
+}
+
+int arena_reserve(arena_t* arena, size_t capacity)
+{
+    if (arena->block != nullptr)
+    {
+        return arena->capacity >= capacity ? 1 : 0;
+    }
+
+    arena->block = (unsigned char*)malloc(capacity);
+    arena->system_calls++;
+
+    if (arena->block == nullptr)
+    {
+        return 0;
+    }
+
+    arena->capacity = capacity;
+    return 1;
+}
+
+// Everything lodepng allocates to decode a file: the IDAT chunks put
+// together (which grow by half), the inflated scanlines (with a filter byte
+// and padding on each line, of each pass if interlaced), the image in the
+// colors of the file and in RGBA, and room for the Huffman trees.
+int arena_reserve_png(arena_t* arena, const unsigned char* png, size_t size)
+{
+    LodePNGState state;
+    unsigned width, height;
+
+    lodepng_state_init(&state);
+    state.decoder.ignore_crc = 1;
+
+    unsigned error = lodepng_inspect(&width, &height, &state, png, size);
+    size_t raw = lodepng_get_raw_size(width, height, &state.info_png.color);
+
+    lodepng_state_cleanup(&state);
+
+    if (error)
+    {
+        return 0;
+    }
+
+    size_t scanlines = raw + (size_t)height * 4 + 16;
+
+    return arena_reserve(arena, size * 2 + scanlines + raw + (size_t)width * height * 4 + 65536);
+}
+
+void* arena_alloc(arena_t* arena, size_t size)
+{
+    size_t needed = ARENA_HEADER_SIZE + arena_round(size);
+
+    if (arena->block == nullptr || needed < size || arena->capacity - arena->top < needed)
+    {
+        void* ptr = malloc(size);
+        arena->system_calls++;
+
+        if (ptr != nullptr)
+        {
+            arena->overflow.push_back(ptr);
+        }
+
+        return ptr;
+    }
+
+    arena_header_t* header = arena_header(arena, arena->top);
+
+    header->size = size;
+    header->previous = arena->last;
+    header->freed = false;
+
+    arena->last = arena->top;
+    arena->top += needed;
+
+    return arena->block + arena->last + ARENA_HEADER_SIZE;
+}
+
+void* arena_realloc(arena_t* arena, void* ptr, size_t size)
+{
+    if (ptr == nullptr)
+    {
+        return arena_alloc(arena, size);
+    }
+
+    if (!arena_owns(arena, ptr))
+    {
+        void* moved = realloc(ptr, size);
+        arena->system_calls++;
+
+        auto found = std::find(arena->overflow.begin(), arena->overflow.end(), ptr);
+
+        if (moved != nullptr && found != arena->overflow.end())
+        {
+            *found = moved;
+        }
+
+        return moved;
+    }
+
+    size_t offset = (unsigned char*)ptr - arena->block - ARENA_HEADER_SIZE;
+    arena_header_t* header = arena_header(arena, offset);
+
+    if (size <= header->size)
+    {
+        return ptr;
+    }
+
+    // The last allocation grows in place, as long as it fits.
+    size_t needed = ARENA_HEADER_SIZE + arena_round(size);
+
+    if (offset == arena->last && needed >= size && arena->capacity - offset >= needed)
+    {
+        header->size = size;
+        arena->top = offset + needed;
+        return ptr;
+    }
+
+    void* moved = arena_alloc(arena, size);
+
+    if (moved != nullptr)
+    {
+        memcpy(moved, ptr, header->size);
+        arena_free(arena, ptr);
+    }
+
+    return moved;
+}
+
+void arena_free(arena_t* arena, void* ptr)
+{
+    if (ptr == nullptr)
+    {
+        return;
+    }
+
+    if (!arena_owns(arena, ptr))
+    {
+        auto found = std::find(arena->overflow.begin(), arena->overflow.end(), ptr);
+
+        if (found != arena->overflow.end())
+        {
+            arena->overflow.erase(found);
+        }
+
+        free(ptr);
+        arena->system_calls++;
+        return;
+    }
+
+    arena_header(arena, (unsigned char*)ptr - arena->block - ARENA_HEADER_SIZE)->freed = true;
+
+    // Give back the allocations at the end which are all freed.
+    while (arena->last != ARENA_NONE && arena_header(arena, arena->last)->freed)
+    {
+        arena->top = arena->last;
+        arena->last = arena_header(arena, arena->last)->previous;
+    }
+}
+
+int arena_system_calls(arena_t* arena)
+{
+    return arena->system_calls;
+}
+
+void arena_use(arena_t* arena)
+{
+    arena_current = arena;
+}
+
+// lodepng is built without its own allocators (LODEPNG_NO_COMPILE_ALLOCATORS).
+
+void* lodepng_malloc(size_t size)
+{
+    return arena_current != nullptr ? arena_alloc(arena_current, size) : malloc(size);
+}
+
+void* lodepng_realloc(void* ptr, size_t new_size)
+{
+    return arena_current != nullptr ? arena_realloc(arena_current, ptr, new_size) : realloc(ptr, new_size);
+}
+
+void lodepng_free(void* ptr)
+{
+    if (arena_current != nullptr)
+    {
+        arena_free(arena_current, ptr);
+    }
+    else
+    {
+        free(ptr);
+    }
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+#include "../include/file.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+struct file_map_t
+{
+    const unsigned char* data;
+    size_t size;
+
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+};
+
+#ifdef _WIN32
+
+file_map_t* file_map(const std::string filename)
+{
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER size;
+
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return nullptr;
+    }
+
+    if (!GetFileSizeEx(file, &size))
+    {
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    auto map = new file_map_t;
+
+    map->file = file;
+    map->mapping = nullptr;
+    map->data = nullptr;
+    map->size = (size_t)size.QuadPart;
+
+    // An empty file can't be mapped, but it is still a file.
+    if (map->size == 0)
+    {
+        return map;
+    }
+
+    map->mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if (map->mapping != nullptr)
+    {
+        map->data = (const unsigned char*)MapViewOfFile(map->mapping, FILE_MAP_READ, 0, 0, 0);
+    }
+
+    if (map->data == nullptr)
+    {
+        file_unmap(map);
+        return nullptr;
+    }
+
+    return map;
+}
+
+void file_unmap(file_map_t* map)
+{
+    if (map == nullptr)
+    {
+        return;
+    }
+
+    if (map->data != nullptr)
+    {
+        UnmapViewOfFile(map->data);
+    }
+
+    if (map->mapping != nullptr)
+    {
+        CloseHandle(map->mapping);
+    }
+
+    CloseHandle(map->file);
+    delete map;
+}
+
+#else
+
+file_map_t* file_map(const std::string filename)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    struct stat status;
+
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+
+    if (fstat(fd, &status) != 0)
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    auto map = new file_map_t;
+
+    map->data = nullptr;
+    map->size = (size_t)status.st_size;
+
+    // An empty file can't be mapped, but it is still a file.
+    if (map->size > 0)
+    {
+        void* data = mmap(nullptr, map->size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (data == MAP_FAILED)
+        {
+            close(fd);
+            delete map;
+            return nullptr;
+        }
+
+        map->data = (const unsigned char*)data;
+    }
+
+    // The mapping stays valid without the descriptor.
+    close(fd);
+
+    return map;
+}
+
+void file_unmap(file_map_t* map)
+{
+    if (map == nullptr)
+    {
+        return;
+    }
+
+    if (map->data != nullptr)
+    {
+        munmap((void*)map->data, map->size);
+    }
+
+    delete map;
+}
+
+#endif
+
+const unsigned char* file_map_data(file_map_t* map)
+{
+    return map->data;
+}
+
+size_t file_map_size(file_map_t* map)
+{
+    return map->size;
+}
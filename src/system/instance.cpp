@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+#include "../include/instance.h"
+
+thread_local instance_t* instance_current = nullptr;
+
+instance_t* instance_create()
+{
+    return new instance_t();
+}
+
+void instance_delete(instance_t* instance)
+{
+    if (instance == nullptr)
+    {
+        return;
+    }
+
+    for (int i = 0; i < INSTANCE_MODULE_COUNT; i++)
+    {
+        if (instance->states[i] != nullptr)
+        {
+            instance->destroy[i](instance->states[i]);
+        }
+    }
+
+    if (instance_current == instance)
+    {
+        instance_current = nullptr;
+    }
+
+    delete instance;
+}
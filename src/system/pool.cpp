@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+#include "../include/pool.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct pool_job_t
+{
+    void(*job)(void* data);
+    void* data;
+};
+
+struct pool_t
+{
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable job_added;
+    std::condition_variable job_done;
+
+    std::deque<pool_job_t> jobs;
+    int running; // jobs taken by a thread and not finished yet
+    bool stopping;
+};
+
+static void pool_thread(pool_t* pool)
+{
+    std::unique_lock<std::mutex> lock(pool->mutex);
+
+    while (true)
+    {
+        pool->job_added.wait(lock, [pool] { return pool->stopping || !pool->jobs.empty(); });
+
+        if (pool->jobs.empty())
+        {
+            // Stopping, and nothing left to do.
+            return;
+        }
+
+        pool_job_t job = pool->jobs.front();
+        pool->jobs.pop_front();
+        pool->running++;
+
+        lock.unlock();
+        job.job(job.data);
+        lock.lock();
+
+        pool->running--;
+
+        if (pool->jobs.empty() && pool->running == 0)
+        {
+            pool->job_done.notify_all();
+        }
+    }
+}
+
+pool_t* pool_create(int thread_count)
+{
+    if (thread_count <= 0)
+    {
+        thread_count = (int)std::thread::hardware_concurrency();
+
+        if (thread_count <= 0)
+        {
+            thread_count = 1;
+        }
+    }
+
+    auto pool = new pool_t;
+    pool->running = 0;
+    pool->stopping = false;
+
+    for (int i = 0; i < thread_count; i++)
+    {
+        pool->threads.push_back(std::thread(pool_thread, pool));
+    }
+
+    return pool;
+}
+
+void pool_delete(pool_t* pool)
+{
+    if (pool == nullptr)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->stopping = true;
+    }
+
+    pool->job_added.notify_all();
+
+    for (auto& thread : pool->threads)
+    {
+        thread.join();
+    }
+
+    delete pool;
+}
+
+void pool_submit(pool_t* pool, void(*job)(void* data), void* data)
+{
+    pool_job_t pool_job;
+    pool_job.job = job;
+    pool_job.data = data;
+
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->jobs.push_back(pool_job);
+    }
+
+    pool->job_added.notify_one();
+}
+
+void pool_wait(pool_t* pool)
+{
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    pool->job_done.wait(lock, [pool] { return pool->jobs.empty() && pool->running == 0; });
+}
+
+int pool_thread_count(pool_t* pool)
+{
+    return (int)pool->threads.size();
+}
@@ -0,0 +1,301 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+// Checks that drawing texts and dialogs allocates nothing once their
+// layouts are cached: a frame of a scene must not reach operator new.
+//
+// font.cpp and dialog.cpp are built as they are, the texture and OpenGL
+// functions they call are replaced below by ones which draw nothing.
+// The levels which show texts are included below, for their render
+// functions and states.
+
+#include "../src/include/audio.h"
+#include "../src/include/dialog.h"
+#include "../src/include/font.h"
+#include "../src/include/game.h"
+#include "../src/include/instance.h"
+#include "../src/include/level.h"
+#include "../src/include/loader.h"
+#include "../src/include/opengl.h"
+#include "../src/include/scene.h"
+#include "../src/include/texture.h"
+#include "../src/include/window.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+// Each in a namespace of its own, their static functions share names.
+namespace level1
+{
+#include "../src/game/level1.cpp"
+}
+
+namespace level2
+{
+#include "../src/game/level2.cpp"
+}
+
+namespace level3
+{
+#include "../src/game/level3.cpp"
+}
+
+static long allocations = 0;
+
+void* operator new(size_t size)
+{
+    allocations++;
+
+    void* ptr = malloc(size == 0 ? 1 : size);
+
+    if (ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+
+    return ptr;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    free(ptr);
+}
+
+// The texture and OpenGL functions used by the text.
+
+struct texture_mesh_t
+{
+    int size;
+};
+
+static int texture_dummy;
+
+texture_t* texture_open(const std::string, int, float)
+{
+    return (texture_t*)&texture_dummy;
+}
+
+void texture_close(texture_t*)
+{
+}
+
+texture_mesh_t* texture_mesh_create(texture_t*)
+{
+    auto mesh = new texture_mesh_t;
+    mesh->size = 0;
+    return mesh;
+}
+
+void texture_mesh_add(texture_mesh_t* mesh, int, int, int)
+{
+    mesh->size++;
+}
+
+int texture_mesh_size(texture_mesh_t* mesh)
+{
+    return mesh->size;
+}
+
+void texture_mesh_close(texture_mesh_t* mesh)
+{
+    delete mesh;
+}
+
+int texture_frame_width(texture_t*)
+{
+    return 8;
+}
+
+int texture_frame_height(texture_t*)
+{
+    return 8;
+}
+
+float texture_frame_duration(texture_t*)
+{
+    return 0.1f;
+}
+
+void opengl_mesh(texture_mesh_t*, int)
+{
+}
+
+void opengl_color(float, float, float)
+{
+}
+
+void opengl_move(int, int)
+{
+}
+
+void opengl_restore(opengl_state_t*)
+{
+}
+
+void opengl_rectangle(int, int)
+{
+}
+
+void opengl_texture(texture_t*, int)
+{
+}
+
+// The levels load nothing here, only their texts are drawn.
+
+void audio_sound_play(audio_t*)
+{
+}
+
+void audio_sound_unload(audio_t*)
+{
+}
+
+loader_t* loader_texture(const std::string, int, float)
+{
+    return nullptr;
+}
+
+loader_t* loader_sound(const std::string)
+{
+    return nullptr;
+}
+
+int loader_ready(loader_t*)
+{
+    return 1;
+}
+
+texture_t* loader_texture_get(loader_t*)
+{
+    return nullptr;
+}
+
+audio_t* loader_sound_get(loader_t*)
+{
+    return nullptr;
+}
+
+void loader_close(loader_t*)
+{
+}
+
+// A few frames of a scene: dialogs being typed, and texts like the levels
+// show, picked from an array and measured to be centered.
+static void text_frames(font_t* font, dialog_t** dialogs, int dialog_count, int frame_count)
+{
+    static const char* const texts[] = {
+        "I still think we should go right.",
+        "Not left, right.",
+        "He's gone.",
+    };
+
+    for (int frame = 0; frame < frame_count; frame++)
+    {
+        for (int i = 0; i < dialog_count; i++)
+        {
+            dialog_update(dialogs[i], 1 / 60.0f);
+            dialog_render(dialogs[i], font);
+        }
+
+        const char* text = texts[frame % 3];
+
+        if (font_width(font, text) > 0)
+        {
+            font_render(font, text);
+        }
+    }
+}
+
+// The texts of the levels, each shown in turn as they would be in a game.
+static void level_frames(font_t* font, game_t* game, int frame_count)
+{
+    opengl_state_t state;
+
+    level1::level1_state_t* level1 = level1::level1_current();
+    level2::level2_state_t* level2 = level2::level2_current();
+    level3::level3_state_t* level3 = level3::level3_current();
+
+    const int complaint_count = sizeof(level1::complaints_texts) / sizeof(level1::complaints_texts[0]);
+    const int boredom_count = sizeof(level2::boredom_text) / sizeof(level2::boredom_text[0]);
+
+    for (int frame = 0; frame < frame_count; frame++)
+    {
+        // The two lines of the monologue, then the complaints.
+        level1->monologue_timer = frame % 3 == 0 ? 3.5f : frame % 3 == 1 ? 1.0f : -1.0f;
+        level1->text_timer = 1.0f;
+        level1->complaint_current = frame % complaint_count;
+        level1->this_level.render(font, &state, game);
+
+        level2->text_timer = 1.0f;
+        level2->boredom_current = frame % boredom_count;
+        level2->this_level.render(font, &state, game);
+
+        level3->text_timer = 1.5f;
+        game->right_disabled = frame % 2 != 0;
+        level3->this_level.render(font, &state, game);
+    }
+}
+
+int main()
+{
+    font_t* font = font_open("data/font.png");
+    dialog_t* dialogs[] = {
+        dialog_init("I wish this moment would never end.", 0.9f, 0.45f, 0.0f, 0.0f),
+        dialog_init("Don't worry. You are about to wake up.", 0.0f, 0.5f, 0.0f, 0.5f),
+    };
+    const int dialog_count = sizeof(dialogs) / sizeof(dialogs[0]);
+
+    instance_current = instance_create();
+
+    game_t game = {};
+    game.father = (texture_t*)&texture_dummy;
+    game.menu = (texture_t*)&texture_dummy;
+
+    level1::level1_get();
+    level2::level2_get();
+    level3::level3_get();
+
+    // The first frames lay the texts out.
+    text_frames(font, dialogs, dialog_count, 3);
+    level_frames(font, &game, 24);
+
+    long before = allocations;
+
+    // Long enough for the dialogs to be fully typed.
+    text_frames(font, dialogs, dialog_count, 600);
+    level_frames(font, &game, 600);
+
+    long during = allocations - before;
+
+    for (int i = 0; i < dialog_count; i++)
+    {
+        dialog_delete(dialogs[i]);
+    }
+
+    font_close(font);
+    instance_delete(instance_current);
+
+    printf("%ld allocations in 600 frames of text.\n", during);
+
+    return during == 0 ? 0 : 1;
+}
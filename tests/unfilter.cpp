@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+// Differential test of the SSE scanline unfiltering of lodepng: every
+// scanline is also unfiltered by the scalar unfilterScanline, and both must
+// match byte for byte.
+//
+// The scanlines are random, with random filter types, pixel widths (3 and 4
+// bytes more often, the ones with SSE versions), lengths, with or without
+// the line above, and with recon separate from the scanline, the same, or a
+// few bytes before it (as unfilter does in place). Each CPU level is tried
+// which the processor has.
+//
+// Usage: a.man-unfilter-test [<iterations>] [<seed>]
+
+// The functions to test are static.
+#include "lodepng/lodepng.cpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#ifdef LODEPNG_SSE2
+
+enum unfilter_alias_t
+{
+    UNFILTER_SEPARATE,
+    UNFILTER_SAME,
+    UNFILTER_BEFORE, // recon a few bytes before the scanline
+    UNFILTER_ALIAS_COUNT
+};
+
+static unsigned char unfilter_byte(std::mt19937& random, int pattern)
+{
+    switch (pattern)
+    {
+        case 0: return (unsigned char)random();
+        case 1: return (unsigned char)(random() % 4); // small differences
+        default: return random() % 2 ? 255 : 0; // overflows
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    long iterations = argc > 1 ? atol(argv[1]) : 200000;
+    std::mt19937 random(argc > 2 ? (unsigned)atol(argv[2]) : 22);
+
+    const unsigned levels[] = { 0, LODEPNG_CPU_SSSE3, LODEPNG_CPU_AVX2, LODEPNG_CPU_SSSE3 | LODEPNG_CPU_AVX2 };
+    unsigned cpu = getCpuFeatures();
+    long failures = 0;
+
+    printf("CPU: SSE2%s%s\n", cpu & LODEPNG_CPU_SSSE3 ? " SSSE3" : "", cpu & LODEPNG_CPU_AVX2 ? " AVX2" : "");
+
+    for (long i = 0; i < iterations; i++)
+    {
+        size_t bytewidth = random() % 2 ? 3 + random() % 2 : 1 + random() % 8;
+        size_t length = random() % 3 ? random() % 80 : random() % 2000;
+        unsigned char filter_type = (unsigned char)(random() % 5);
+        bool first_line = random() % 8 == 0;
+        auto alias = (unfilter_alias_t)(random() % UNFILTER_ALIAS_COUNT);
+        unsigned level = levels[random() % 4] & cpu;
+        int pattern = random() % 3;
+
+        length = length < bytewidth ? bytewidth : length / bytewidth * bytewidth;
+
+        std::vector<unsigned char> scanline(length), precon(length), expected(length), buffer(length + 16);
+
+        for (size_t j = 0; j < length; j++)
+        {
+            scanline[j] = unfilter_byte(random, pattern);
+            precon[j] = unfilter_byte(random, pattern);
+        }
+
+        const unsigned char* above = first_line ? nullptr : precon.data();
+        unsigned expected_error = unfilterScanline(expected.data(), scanline.data(), above, bytewidth,
+                                                   filter_type, length);
+
+        unsigned char* recon = buffer.data();
+        const unsigned char* input = scanline.data();
+
+        if (alias != UNFILTER_SEPARATE)
+        {
+            size_t offset = alias == UNFILTER_BEFORE ? 1 + random() % 8 : 0;
+
+            memcpy(buffer.data() + offset, scanline.data(), length);
+            input = buffer.data() + offset;
+        }
+
+        unsigned error = unfilterScanlineSSE(recon, input, above, bytewidth, filter_type, length, level);
+
+        if (error != expected_error || (!error && memcmp(recon, expected.data(), length) != 0))
+        {
+            if (failures++ < 10)
+            {
+                printf("Mismatch: filter %d, bytewidth %zu, length %zu, first line %d, alias %d, CPU level %u\n",
+                       filter_type, bytewidth, length, first_line, (int)alias, level);
+            }
+        }
+    }
+
+    printf("%ld scanlines, %ld mismatches\n", iterations, failures);
+
+    return failures == 0 ? 0 : 1;
+}
+
+#else
+
+int main()
+{
+    printf("lodepng is built without SSE2, nothing to test.\n");
+    return 0;
+}
+
+#endif
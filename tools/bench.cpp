@@ -0,0 +1,250 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+// Times lodepng on the images of the game: the inflating of the IDAT
+// chunks alone (without the Adler-32 check), then the whole decoding to
+// RGBA. A file which isn't a PNG is taken as a zlib stream, and only
+// inflated.
+//
+// Usage: a.man-bench [-r <repetitions>] <file>...
+//
+// Each file is decoded as many times (20 by default) and the fastest run is
+// kept. The throughput is the size of the output per second.
+//
+// The decoding is done like the game does it, in an arena reserved from
+// the header (see arena.h). The calls to the system allocator are counted
+// that way, and without reserving, where every lodepng allocation is one.
+
+#include "../src/include/arena.h"
+#include "lodepng/lodepng.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct bench_total_t
+{
+    double inflate_bytes, inflate_seconds;
+    double decode_bytes, decode_seconds;
+    int malloc_calls, arena_calls;
+};
+
+static double bench_seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double bench_rate(double bytes, double seconds)
+{
+    return seconds > 0.0 ? bytes / seconds / (1024.0 * 1024.0) : 0.0;
+}
+
+// With reserve false, nothing fits in the arena and all goes to malloc.
+static unsigned bench_decode(const std::vector<unsigned char>& png, bool reserve, unsigned* width, unsigned* height,
+                             int* allocator_calls)
+{
+    arena_t* arena = arena_create();
+    unsigned char* image;
+    LodePNGState state;
+
+    lodepng_state_init(&state);
+    state.info_raw.colortype = LCT_RGBA;
+    state.info_raw.bitdepth = 8;
+
+    if (reserve)
+    {
+        arena_reserve_png(arena, png.data(), png.size());
+    }
+
+    arena_use(arena);
+    unsigned error = lodepng_decode(&image, width, height, &state, png.data(), png.size());
+    lodepng_state_cleanup(&state);
+    arena_use(nullptr);
+
+    *allocator_calls = arena_system_calls(arena);
+    arena_delete(arena);
+
+    return error;
+}
+
+static bool bench_is_png(const std::vector<unsigned char>& file)
+{
+    static const unsigned char signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+
+    return file.size() >= sizeof(signature) && memcmp(file.data(), signature, sizeof(signature)) == 0;
+}
+
+// The zlib stream of the image, its IDAT chunks put together.
+static bool bench_idat(const std::vector<unsigned char>& png, std::vector<unsigned char>& idat)
+{
+    const unsigned char* chunk = png.data() + 8;
+    const unsigned char* end = png.data() + png.size();
+
+    while (chunk + 12 <= end && chunk + 12 + lodepng_chunk_length(chunk) <= end)
+    {
+        if (lodepng_chunk_type_equals(chunk, "IDAT"))
+        {
+            const unsigned char* data = lodepng_chunk_data_const(chunk);
+            idat.insert(idat.end(), data, data + lodepng_chunk_length(chunk));
+        }
+        else if (lodepng_chunk_type_equals(chunk, "IEND"))
+        {
+            return true;
+        }
+
+        chunk = lodepng_chunk_next_const(chunk);
+    }
+
+    return false;
+}
+
+static bool bench_file(const char* filename, int repetitions, bench_total_t* total)
+{
+    unsigned char* buffer;
+    size_t size;
+
+    if (lodepng_load_file(&buffer, &size, filename) != 0)
+    {
+        std::cout << "Could not open '" << filename << "'." << std::endl;
+        return false;
+    }
+
+    std::vector<unsigned char> png(buffer, buffer + size);
+    std::vector<unsigned char> idat;
+    free(buffer);
+
+    bool is_png = bench_is_png(png);
+
+    if (!is_png)
+    {
+        idat = png;
+    }
+    else if (!bench_idat(png, idat))
+    {
+        std::cout << "'" << filename << "' has no complete IDAT data." << std::endl;
+        return false;
+    }
+
+    LodePNGDecompressSettings settings;
+    lodepng_decompress_settings_init(&settings);
+    settings.ignore_adler32 = 1;
+
+    double inflate_best = 1e9, decode_best = 1e9;
+    size_t inflated = 0;
+    unsigned width = 0, height = 0;
+    int malloc_calls = 0, arena_calls = 0;
+
+    for (int i = 0; i < repetitions; i++)
+    {
+        unsigned char* out = nullptr;
+        size_t outsize = 0;
+        auto start = std::chrono::steady_clock::now();
+        unsigned error = lodepng_zlib_decompress(&out, &outsize, idat.data(), idat.size(), &settings);
+
+        inflate_best = std::min(inflate_best, bench_seconds(start));
+        inflated = outsize;
+        free(out);
+
+        if (error)
+        {
+            std::cout << "'" << filename << "' could not be inflated: " << lodepng_error_text(error) << std::endl;
+            return false;
+        }
+    }
+
+    for (int i = 0; is_png && i < repetitions; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        unsigned error = bench_decode(png, true, &width, &height, &arena_calls);
+
+        decode_best = std::min(decode_best, bench_seconds(start));
+
+        if (!error && i == 0)
+        {
+            error = bench_decode(png, false, &width, &height, &malloc_calls);
+        }
+
+        if (error)
+        {
+            std::cout << "'" << filename << "' could not be decoded: " << lodepng_error_text(error) << std::endl;
+            return false;
+        }
+    }
+
+    total->inflate_bytes += inflated;
+    total->inflate_seconds += inflate_best;
+
+    if (!is_png)
+    {
+        printf("%-24s %11s inflate %8.3f ms %8.1f MB/s\n", filename, "zlib",
+               inflate_best * 1000.0, bench_rate(inflated, inflate_best));
+        return true;
+    }
+
+    size_t decoded = (size_t)width * height * 4;
+
+    printf("%-24s %5ux%-5u inflate %8.3f ms %8.1f MB/s   decode %8.3f ms %8.1f MB/s   allocs %3d -> %d\n",
+           filename, width, height,
+           inflate_best * 1000.0, bench_rate(inflated, inflate_best),
+           decode_best * 1000.0, bench_rate(decoded, decode_best),
+           malloc_calls, arena_calls);
+
+    total->decode_bytes += decoded;
+    total->decode_seconds += decode_best;
+    total->malloc_calls += malloc_calls;
+    total->arena_calls += arena_calls;
+
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    bench_total_t total = { 0.0, 0.0, 0.0, 0.0, 0, 0 };
+    int repetitions = 20;
+    int first = 1;
+
+    if (argc > 2 && strcmp(argv[1], "-r") == 0)
+    {
+        repetitions = std::max(1, atoi(argv[2]));
+        first = 3;
+    }
+
+    if (first >= argc)
+    {
+        std::cout << "Usage: " << argv[0] << " [-r <repetitions>] <file>..." << std::endl;
+        return 1;
+    }
+
+    for (int i = first; i < argc; i++)
+    {
+        if (!bench_file(argv[i], repetitions, &total))
+        {
+            return 1;
+        }
+    }
+
+    printf("%-24s %11s inflate %8.3f ms %8.1f MB/s", "total", "",
+           total.inflate_seconds * 1000.0, bench_rate(total.inflate_bytes, total.inflate_seconds));
+
+    if (total.decode_bytes > 0.0)
+    {
+        printf("   decode %8.3f ms %8.1f MB/s   allocs %3d -> %d", total.decode_seconds * 1000.0,
+               bench_rate(total.decode_bytes, total.decode_seconds), total.malloc_calls, total.arena_calls);
+    }
+
+    printf("\n");
+
+    return 0;
+}
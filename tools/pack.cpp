@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2012 Marc-Olivier Bloch <wormsparty [at] gmail [dot] com>
+ *
+ * This file is part of the 'Beautiful, absurd, subtle.' project.
+ *
+ * 'Beautiful, absurd, subtle.' is free software: you can redistribute it
+ * and/or modify it under the terms of the 'New BSD License'.
+ *
+ */
+
+// Decodes the images and sounds of the game once, into an archive the
+// game maps in memory instead of decoding them every time it starts.
+//
+// Usage: a.man-pack <list> <archive>
+//
+// Each line of the list is the name of a file, as the game opens it.
+// Images (.png) are followed by their frame count and frame duration.
+
+#include "../src/include/pack.h"
+#include "../src/include/vorbis.h"
+#include "lodepng/lodepng.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+struct pack_file_t
+{
+    pack_entry_t entry;
+    std::vector<unsigned char> data;
+};
+
+static bool ends_with(const std::string& str, const std::string& end)
+{
+    return str.size() >= end.size() && str.compare(str.size() - end.size(), end.size(), end) == 0;
+}
+
+static bool pack_image(pack_file_t* file, const std::string& name, std::istringstream& line)
+{
+    unsigned char* image;
+    unsigned width, height;
+    unsigned error = lodepng_decode32_file(&image, &width, &height, name.c_str());
+
+    if (error)
+    {
+        std::cout << "'" << name << "' could not be loaded: " << lodepng_error_text(error) << std::endl;
+        return false;
+    }
+
+    file->entry.type = PACK_IMAGE;
+    file->entry.width = width;
+    file->entry.height = height;
+    file->entry.frame_count = 1;
+    file->entry.frame_duration = 0.0f;
+    line >> file->entry.frame_count >> file->entry.frame_duration;
+
+    // The game wouldn't open the archive.
+    if (file->entry.frame_count == 0 || width % file->entry.frame_count != 0)
+    {
+        std::cout << "'" << name << "' is " << width << " pixels wide, which can't be "
+                  << file->entry.frame_count << " frames." << std::endl;
+        free(image);
+        return false;
+    }
+
+    file->data.assign(image, image + (size_t)width * height * 4);
+    free(image);
+
+    return true;
+}
+
+static bool pack_sound(pack_file_t* file, const std::string& name)
+{
+    int channels;
+    long samplerate;
+    vorbis_t* vorbis = vorbis_open(name, &channels, &samplerate);
+
+    if (vorbis == nullptr)
+    {
+        std::cout << "'" << name << "' could not be loaded." << std::endl;
+        return false;
+    }
+
+    char buffer[4096];
+    size_t read;
+
+    while ((read = vorbis_read(vorbis, buffer, sizeof(buffer))) > 0)
+    {
+        file->data.insert(file->data.end(), buffer, buffer + read);
+    }
+
+    vorbis_close(vorbis);
+
+    file->entry.type = PACK_SOUND;
+    file->entry.channels = (uint32_t)channels;
+    file->entry.samplerate = (uint32_t)samplerate;
+
+    return true;
+}
+
+static bool pack_list_read(const char* filename, std::vector<pack_file_t>& files)
+{
+    std::ifstream list(filename);
+    std::string text;
+
+    if (!list)
+    {
+        std::cout << "Could not open '" << filename << "'." << std::endl;
+        return false;
+    }
+
+    while (std::getline(list, text))
+    {
+        std::istringstream line(text);
+        std::string name;
+
+        if (!(line >> name) || name[0] == '#')
+        {
+            continue;
+        }
+
+        if (name.size() >= PACK_NAME_SIZE)
+        {
+            std::cout << "'" << name << "' is too long a name, at most " << PACK_NAME_SIZE - 1
+                      << " characters." << std::endl;
+            return false;
+        }
+
+        pack_file_t file;
+
+        memset(&file.entry, 0, sizeof(file.entry));
+        strncpy(file.entry.name, name.c_str(), PACK_NAME_SIZE - 1);
+
+        if (ends_with(name, ".png") ? !pack_image(&file, name, line) : !pack_sound(&file, name))
+        {
+            return false;
+        }
+
+        files.push_back(file);
+    }
+
+    return true;
+}
+
+static bool pack_write(const char* filename, std::vector<pack_file_t>& files)
+{
+    pack_header_t header;
+    static const char padding[PACK_ALIGNMENT] = { 0 };
+
+    // The game looks the files up by name.
+    std::sort(files.begin(), files.end(), [](const pack_file_t& a, const pack_file_t& b)
+    {
+        return strncmp(a.entry.name, b.entry.name, PACK_NAME_SIZE) < 0;
+    });
+
+    // The game refuses an archive with a name twice.
+    for (size_t i = 1; i < files.size(); i++)
+    {
+        if (strncmp(files[i - 1].entry.name, files[i].entry.name, PACK_NAME_SIZE) == 0)
+        {
+            std::cout << "'" << files[i].entry.name << "' is listed more than once." << std::endl;
+            return false;
+        }
+    }
+
+    memset(&header, 0, sizeof(header));
+    strncpy(header.magic, PACK_MAGIC, sizeof(header.magic) - 1);
+    header.entry_count = (uint32_t)files.size();
+
+    size_t offset = sizeof(header) + files.size() * sizeof(pack_entry_t);
+
+    for (auto& file : files)
+    {
+        offset = (offset + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT;
+
+        if (offset + file.data.size() > UINT32_MAX)
+        {
+            std::cout << "The archive would be too large." << std::endl;
+            return false;
+        }
+
+        file.entry.offset = (uint32_t)offset;
+        file.entry.size = (uint32_t)file.data.size();
+        offset += file.data.size();
+    }
+
+    FILE* out = fopen(filename, "wb");
+
+    if (out == nullptr)
+    {
+        std::cout << "Could not open '" << filename << "' for writing." << std::endl;
+        return false;
+    }
+
+    size_t written = sizeof(header) + files.size() * sizeof(pack_entry_t);
+
+    fwrite(&header, sizeof(header), 1, out);
+
+    for (auto& file : files)
+    {
+        fwrite(&file.entry, sizeof(file.entry), 1, out);
+    }
+
+    for (auto& file : files)
+    {
+        fwrite(padding, 1, file.entry.offset - written, out);
+        fwrite(file.data.data(), 1, file.data.size(), out);
+        written = file.entry.offset + file.data.size();
+    }
+
+    if (fclose(out) != 0)
+    {
+        std::cout << "Could not write '" << filename << "'." << std::endl;
+        return false;
+    }
+
+    std::cout << "Packed " << files.size() << " files in " << filename << " (" << written / 1024 << " KB)." << std::endl;
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<pack_file_t> files;
+
+    if (argc != 3)
+    {
+        std::cout << "Usage: " << argv[0] << " <list> <archive>" << std::endl;
+        return 1;
+    }
+
+    if (!pack_list_read(argv[1], files) || !pack_write(argv[2], files))
+    {
+        return 1;
+    }
+
+    return 0;
+}